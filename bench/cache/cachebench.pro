@@ -0,0 +1,32 @@
+# Microbenchmark of the resource cache index against the flat list it replaced. Build and run
+# it from this folder with:
+#   qmake && make && ./cachebench [resources]
+TEMPLATE = app
+TARGET = cachebench
+DEPENDPATH += . ../../src
+INCLUDEPATH += . ../../src
+CONFIG += release console
+CONFIG -= app_bundle
+QT += core network xml concurrent
+QMAKE_CXXFLAGS += -std=c++11
+
+HEADERS += legacycache.h \
+           ../../src/cache.h \
+           ../../src/queue.h \
+           ../../src/gameentry.h \
+           ../../src/nametools.h \
+           ../../src/strtools.h \
+           ../../src/filetools.h \
+           ../../src/digest.h \
+           ../../src/crc32.h
+
+SOURCES += main.cpp \
+           legacycache.cpp \
+           ../../src/cache.cpp \
+           ../../src/queue.cpp \
+           ../../src/gameentry.cpp \
+           ../../src/nametools.cpp \
+           ../../src/strtools.cpp \
+           ../../src/filetools.cpp \
+           ../../src/digest.cpp \
+           ../../src/crc32.cpp
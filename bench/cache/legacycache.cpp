@@ -0,0 +1,330 @@
+/***************************************************************************
+ *            legacycache.cpp
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include "legacycache.h"
+
+// The lookups of the resource cache as they were while all resources were kept in a flat list.
+// The functions below are copied unchanged from the version before the resources were indexed,
+// so the benchmark compares the real code paths. Only what the benchmark calls is kept
+LegacyCache::LegacyCache(const QString &cacheFolder, const QList<Resource> &resources)
+  : cacheDir(cacheFolder), resources(resources)
+{
+}
+
+bool LegacyCache::hasEntries(const QString &cacheId, const QString scraper)
+{
+  QMutexLocker locker(&cacheMutex);
+  for(const auto &res: resources) {
+    if(scraper.isEmpty()) {
+      if(res.cacheId == cacheId) {
+	return true;
+      }
+    } else {
+      if(res.cacheId == cacheId && res.source == scraper) {
+	return true;
+      }
+    }
+  }
+  return false;
+}
+
+void LegacyCache::fillBlanks(GameEntry &entry, const QString scraper)
+{
+  QMutexLocker locker(&cacheMutex);
+  QList<Resource> matchingResources;
+  // Find all resources related to this particular rom
+  for(const auto &resource: resources) {
+    if(scraper.isEmpty()) {
+      if(entry.cacheId == resource.cacheId) {
+	matchingResources.append(resource);
+      }
+    } else {
+      if(entry.cacheId == resource.cacheId && resource.source == scraper) {
+	matchingResources.append(resource);
+      }
+    }
+  }
+
+  {
+    QString type = "title";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      entry.title = result;
+      entry.titleSrc = source;
+    }
+  }
+  {
+    QString type = "platform";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      entry.platform = result;
+      entry.platformSrc = source;
+    }
+  }
+  {
+    QString type = "description";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      entry.description = result;
+      entry.descriptionSrc = source;
+    }
+  }
+  {
+    QString type = "publisher";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      entry.publisher = result;
+      entry.publisherSrc = source;
+    }
+  }
+  {
+    QString type = "developer";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      entry.developer = result;
+      entry.developerSrc = source;
+    }
+  }
+  {
+    QString type = "players";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      entry.players = result;
+      entry.playersSrc = source;
+    }
+  }
+  {
+    QString type = "ages";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      entry.ages = result;
+      entry.agesSrc = source;
+    }
+  }
+  {
+    QString type = "tags";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      entry.tags = result;
+      entry.tagsSrc = source;
+    }
+  }
+  {
+    QString type = "rating";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      entry.rating = result;
+      entry.ratingSrc = source;
+    }
+  }
+  {
+    QString type = "releasedate";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      entry.releaseDate = result;
+      entry.releaseDateSrc = source;
+    }
+  }
+  {
+    QString type = "cover";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      QFile f(cacheDir.absolutePath() + "/" + result);
+      if(f.open(QIODevice::ReadOnly)) {
+	entry.coverData = f.readAll();
+	f.close();
+      }
+      entry.coverSrc = source;
+    }
+  }
+  {
+    QString type = "screenshot";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      QFile f(cacheDir.absolutePath() + "/" + result);
+      if(f.open(QIODevice::ReadOnly)) {
+	entry.screenshotData = f.readAll();
+	f.close();
+      }
+      entry.screenshotSrc = source;
+    }
+  }
+  {
+    QString type = "wheel";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      QFile f(cacheDir.absolutePath() + "/" + result);
+      if(f.open(QIODevice::ReadOnly)) {
+	entry.wheelData = f.readAll();
+	f.close();
+      }
+      entry.wheelSrc = source;
+    }
+  }
+  {
+    QString type = "marquee";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      QFile f(cacheDir.absolutePath() + "/" + result);
+      if(f.open(QIODevice::ReadOnly)) {
+	entry.marqueeData = f.readAll();
+	f.close();
+      }
+      entry.marqueeSrc = source;
+    }
+  }
+  {
+    QString type = "video";
+    QString result = "";
+    QString source = "";
+    if(fillType(type, matchingResources, result, source)) {
+      QFileInfo info(cacheDir.absolutePath() + "/" + result);
+      QFile f(info.absoluteFilePath());
+      if(f.open(QIODevice::ReadOnly)) {
+	entry.videoData = f.readAll();
+	f.close();
+	entry.videoFormat = info.suffix();
+	entry.videoFile = info.absoluteFilePath();
+	entry.videoSrc = source;
+      }
+    }
+  }
+}
+
+bool LegacyCache::fillType(QString &type, QList<Resource> &matchingResources,
+		     QString &result, QString &source)
+{
+  QList<Resource> typeResources;
+  for(const auto &resource: matchingResources) {
+    if(resource.type == type) {
+      typeResources.append(resource);
+    }
+  }
+  if(typeResources.isEmpty()) {
+    return false;
+  }
+  if(prioMap.contains(type)) {
+    for(int a = 0; a < prioMap.value(type).length(); ++a) {
+      for(const auto &resource: typeResources) {
+	if(resource.source == prioMap.value(type).at(a)) {
+	  result = resource.value;
+	  source = resource.source;
+	  return true;
+	}
+      }
+    }
+  }
+  qint64 newest = 0;
+  for(const auto &resource: typeResources) {
+    if(resource.timestamp >= newest) {
+      newest = resource.timestamp;
+      result = resource.value;
+      source = resource.source;
+    }
+  }  
+  return true;
+}
+
+void LegacyCache::merge(Cache &mergeCache, bool overwrite, const QString &mergeCacheFolder)
+{
+  printf("Merging databases, please wait...\n");
+  QList<Resource> mergeResources = mergeCache.getResources();
+
+  QDir mergeCacheDir(mergeCacheFolder);
+
+  int resUpdated = 0;
+  int resMerged = 0;
+
+  for(const auto &mergeResource: mergeResources) {
+    bool resExists = false;
+    // This type of iterator ensures we can delete items while iterating
+    QMutableListIterator<Resource> it(resources);
+    while(it.hasNext()) {
+      Resource res = it.next();
+      if(res.cacheId == mergeResource.cacheId &&
+	 res.type == mergeResource.type &&
+	 res.source == mergeResource.source) {
+	if(overwrite) {
+	  if(res.type == "cover" || res.type == "screenshot" ||
+	     res.type == "wheel" || res.type == "marquee" ||
+	     res.type == "video") {
+	    if(!QFile::remove(cacheDir.absolutePath() + "/" + res.value)) {
+	      printf("Couldn't remove media file '%s' for updating, skipping...\n", res.value.toStdString().c_str());
+	      continue;
+	    }
+	    
+	  }
+	  it.remove();
+	} else {
+	  resExists = true;
+	  break;
+	}
+      }
+    }
+    if(!resExists) {
+      if(mergeResource.type == "cover" || mergeResource.type == "screenshot" ||
+	 mergeResource.type == "wheel" || mergeResource.type == "marquee" ||
+	 mergeResource.type == "video") {
+	cacheDir.mkpath(QFileInfo(cacheDir.absolutePath() + "/" + mergeResource.value).absolutePath());
+	if(!QFile::copy(mergeCacheDir.absolutePath() + "/" + mergeResource.value,
+			cacheDir.absolutePath() + "/" + mergeResource.value)) {
+	  printf("Couldn't copy media file '%s', skipping...\n",  mergeResource.value.toStdString().c_str());
+	  continue;
+	}
+      }
+      if(overwrite) {
+	resUpdated++;
+      } else {
+	resMerged++;
+      }
+      resources.append(mergeResource);
+    }
+  }
+  printf("Successfully updated %d resource(s) in cache!\n", resUpdated);
+  printf("Successfully merged %d new resource(s) into cache!\n\n", resMerged);
+}
+
+QList<Resource> LegacyCache::getResources()
+{
+  return resources;
+}
@@ -1,8 +1,8 @@
 /***************************************************************************
- *            fxcontrast.h
+ *            legacycache.h
  *
- *  Sat Feb 3 12:00:00 CEST 2018
- *  Copyright 2018 Lars Muldjord
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
  *  muldjordlars@gmail.com
  ****************************************************************************/
 /*
@@ -23,24 +23,34 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
  */
 
-#ifndef FXCONTRAST_H
-#define FXCONTRAST_H
+#ifndef LEGACYCACHE_H
+#define LEGACYCACHE_H
 
-#include <QImage>
+#include <QDir>
+#include <QMutex>
+#include <QMap>
+#include <QList>
 
-#include "layer.h"
+#include "cache.h"
 
-class FxContrast : public QObject
+class LegacyCache
 {
-  Q_OBJECT
-
 public:
-  FxContrast();
-  QImage applyEffect(const QImage &src, const Layer &layer);
+  LegacyCache(const QString &cacheFolder, const QList<Resource> &resources);
+  bool hasEntries(const QString &cacheId, const QString scraper = "");
+  void fillBlanks(GameEntry &entry, const QString scraper = "");
+  void merge(LegacyCache &mergeCache, bool overwrite, const QString &mergeCacheFolder);
+  QList<Resource> getResources();
 
 private:
-  int truncate(int value);
+  bool fillType(QString &type, QList<Resource> &matchingResources,
+		QString &result, QString &source);
+
+  QDir cacheDir;
+  QMutex cacheMutex;
+  QMap<QString, QList<QString> > prioMap;
+  QList<Resource> resources;
 
 };
 
-#endif // FXCONTRAST_H
+#endif // LEGACYCACHE_H
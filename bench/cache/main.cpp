@@ -0,0 +1,172 @@
+/***************************************************************************
+ *            main.cpp
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <cstdio>
+
+#include <QCoreApplication>
+#include <QTemporaryDir>
+#include <QXmlStreamWriter>
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include "cache.h"
+#include "legacycache.h"
+
+// Text resource types written for every cache id
+static const QStringList types = {"title", "platform", "description", "publisher", "developer",
+				  "players", "ages", "tags", "rating", "releasedate"};
+
+static QList<Resource> makeResources(const int &firstId, const int &ids, const QString &source)
+{
+  QList<Resource> resources;
+  for(int id = firstId; id < firstId + ids; ++id) {
+    for(const auto &type: types) {
+      Resource resource;
+      resource.cacheId = QString::number(id);
+      resource.type = type;
+      resource.source = source;
+      resource.value = type + " " + QString::number(id);
+      resource.timestamp = 1600000000000;
+      resources.append(resource);
+    }
+  }
+  return resources;
+}
+
+static bool writeDatabase(const QString &folder, const QList<Resource> &resources)
+{
+  QFile dbFile(folder + "/db.xml");
+  if(!dbFile.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+  QXmlStreamWriter xml(&dbFile);
+  xml.writeStartDocument();
+  xml.writeStartElement("resources");
+  for(const auto &resource: resources) {
+    xml.writeStartElement("resource");
+    xml.writeAttribute("id", resource.cacheId);
+    xml.writeAttribute("type", resource.type);
+    xml.writeAttribute("source", resource.source);
+    xml.writeAttribute("timestamp", QString::number(resource.timestamp));
+    xml.writeCharacters(resource.value);
+    xml.writeEndElement();
+  }
+  xml.writeEndElement();
+  xml.writeEndDocument();
+  return true;
+}
+
+static void printResult(const char *name, const qint64 &indexed, const qint64 &flat, const int &calls)
+{
+  printf("%-12s %12.3f us %12.3f us %10.0fx\n", name, indexed / 1000.0 / calls, flat / 1000.0 / calls,
+	 (double)flat / qMax((qint64)1, indexed));
+}
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+
+  int total = 100000;
+  if(app.arguments().length() > 1) {
+    total = app.arguments().at(1).toInt();
+  }
+  int ids = qMax(1, total / types.length());
+  // Every call of the flat list version scans all resources, so only a sample of the cache ids
+  // is looked up. Both versions get the same sample
+  int samples = qMin(ids, 200);
+
+  QList<Resource> resources = makeResources(0, ids, "screenscraper");
+  // Half of the merged resources are new, the other half already exist
+  QList<Resource> mergeResources = makeResources(ids - samples / 2, samples, "screenscraper");
+  QTemporaryDir cacheDir, mergeDir;
+  if(!cacheDir.isValid() || !mergeDir.isValid() ||
+     !writeDatabase(cacheDir.path(), resources) ||
+     !writeDatabase(mergeDir.path(), mergeResources)) {
+    printf("Couldn't create the test databases, now quitting...\n");
+    return 1;
+  }
+  printf("Benchmarking %d resources for %d cache ids, %d sampled calls\n\n",
+	 resources.length(), ids, samples);
+
+  Cache cache(cacheDir.path());
+  Cache mergeCache(mergeDir.path());
+  if(!cache.read() || !mergeCache.read()) {
+    printf("Couldn't read the test databases, now quitting...\n");
+    return 1;
+  }
+  LegacyCache legacyCache(cacheDir.path(), resources);
+  LegacyCache legacyMergeCache(mergeDir.path(), mergeResources);
+  QList<QString> sampleIds;
+  for(int sample = 0; sample < samples; ++sample) {
+    sampleIds.append(QString::number((qint64)sample * ids / samples));
+  }
+
+  printf("%-12s %15s %15s %11s\n", "", "indexed", "flat list", "speedup");
+  QElapsedTimer timer;
+  qint64 indexed = 0, flat = 0;
+  int found = 0, legacyFound = 0;
+  timer.start();
+  for(const auto &cacheId: sampleIds) {
+    found += cache.hasEntries(cacheId, "screenscraper");
+  }
+  indexed = timer.nsecsElapsed();
+  timer.start();
+  for(const auto &cacheId: sampleIds) {
+    legacyFound += legacyCache.hasEntries(cacheId, "screenscraper");
+  }
+  flat = timer.nsecsElapsed();
+  printResult("hasEntries()", indexed, flat, samples);
+
+  timer.start();
+  for(const auto &cacheId: sampleIds) {
+    GameEntry entry;
+    entry.cacheId = cacheId;
+    cache.fillBlanks(entry, "screenscraper");
+  }
+  indexed = timer.nsecsElapsed();
+  timer.start();
+  for(const auto &cacheId: sampleIds) {
+    GameEntry entry;
+    entry.cacheId = cacheId;
+    legacyCache.fillBlanks(entry, "screenscraper");
+  }
+  flat = timer.nsecsElapsed();
+  printResult("fillBlanks()", indexed, flat, samples);
+
+  // Per merged resource. Both print their own summary
+  timer.start();
+  cache.merge(mergeCache, false, mergeDir.path());
+  indexed = timer.nsecsElapsed();
+  timer.start();
+  legacyCache.merge(legacyMergeCache, false, mergeDir.path());
+  flat = timer.nsecsElapsed();
+  printResult("merge()", indexed, flat, mergeResources.length());
+
+  if(found != legacyFound || found != samples) {
+    printf("\nThe two versions disagree, found %d and %d of %d!\n", found, legacyFound, samples);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,89 @@
+#!/bin/bash
+# End-to-end benchmark of full scraping runs. Every run starts from an empty cache and answers
+# all network requests from recorded fixtures, so the runs are comparable with each other and
+# across builds. Record the fixtures once with '-r', which does use the network.
+#
+# Usage: benchmark.sh [-r] [-n RUNS] [-t THREADS] [-b SKYSCRAPER] PLATFORM MODULE ROMFOLDER FIXTUREFOLDER [-- EXTRA OPTIONS]
+# Example: benchmark.sh -r -n 5 snes screenscraper ~/RetroPie/roms/snes ~/fixtures/snes -- -u user:pass
+
+set -o pipefail
+
+RUNS=3
+THREADS=""
+RECORD=0
+SKYSCRAPER=Skyscraper
+
+while getopts "rn:t:b:" OPTION
+do
+    case $OPTION in
+	r) RECORD=1 ;;
+	n) RUNS=$OPTARG ;;
+	t) THREADS="-t $OPTARG" ;;
+	b) SKYSCRAPER=$OPTARG ;;
+	*) exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -lt 4 ]
+then
+    echo "Usage: $0 [-r] [-n RUNS] [-t THREADS] [-b SKYSCRAPER] PLATFORM MODULE ROMFOLDER FIXTUREFOLDER [-- EXTRA OPTIONS]"
+    exit 1
+fi
+PLATFORM=$1
+MODULE=$2
+ROMFOLDER=`realpath "$3"`
+FIXTUREFOLDER=`realpath -m "$4"`
+shift 4
+if [ "$1" == "--" ]
+then
+    shift
+fi
+
+WORKDIR=`mktemp -d`
+trap 'rm -rf "$WORKDIR"' EXIT
+# Skyscraper reads relative paths from its own folder, so everything it gets is absolute
+cat > "$WORKDIR/config.ini" <<CONFIG
+[main]
+fixtureFolder="$FIXTUREFOLDER"
+CONFIG
+
+# Runs Skyscraper once with an empty cache and prints the wall time and time spent per stage
+scrape () {
+    local FLAGS=$1
+    shift
+    rm -rf "$WORKDIR/cache"
+    local START=`date +%s%N`
+    "$SKYSCRAPER" -p "$PLATFORM" -s "$MODULE" -i "$ROMFOLDER" -d "$WORKDIR/cache" -c "$WORKDIR/config.ini" $THREADS --flags unattend,$FLAGS "$@" > "$WORKDIR/output.txt" 2>&1 < /dev/null
+    local EXITCODE=$?
+    local END=`date +%s%N`
+    if [ $EXITCODE -ne 0 ]
+    then
+	# Runs are piped into the table below, so errors go to stderr
+	echo "--- Skyscraper exited with code $EXITCODE, output is below ---" >&2
+	cat "$WORKDIR/output.txt" >&2
+	exit $EXITCODE
+    fi
+    sed 's/\x1b\[[0-9;]*m//g' "$WORKDIR/output.txt" | awk -v wall=$(( (END - START) / 1000000 )) '
+	/^  Rom checksums:/ { checksums = $3 }
+	/^  Searching:/ { search = $2 }
+	/^  Game data:/ { gamedata = $3 }
+	/^  Processing:/ { processing = $2 }
+	END { printf "%.2f %s %s %s %s\n", wall / 1000.0, checksums, search, gamedata, processing }'
+}
+
+if [ $RECORD -eq 1 ]
+then
+    echo "--- Recording fixtures to '$FIXTUREFOLDER' ---"
+    scrape record "$@" > /dev/null
+fi
+
+echo "--- Replaying $RUNS runs of '$MODULE' on '$PLATFORM' ---"
+for RUN in `seq 1 $RUNS`
+do
+    scrape replay "$@"
+done | awk '
+    BEGIN { printf "%-8s %10s %10s %10s %10s %10s\n", "run", "total", "checksums", "search", "gamedata", "process" }
+    { printf "%-8d %10.2f %10.2f %10.2f %10.2f %10.2f\n", NR, $1, $2, $3, $4, $5
+      for(i = 1; i <= 5; i++) { sum[i] += $i } }
+    END { if(NR > 0) printf "%-8s %10.2f %10.2f %10.2f %10.2f %10.2f\n", "average", sum[1] / NR, sum[2] / NR, sum[3] / NR, sum[4] / NR, sum[5] / NR }'
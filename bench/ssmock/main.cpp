@@ -0,0 +1,72 @@
+/***************************************************************************
+ *            main.cpp
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <cstdio>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+
+#include "mockserver.h"
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Stand-in for the ScreenScraper API. Point Skyscraper at it by setting 'baseUrl=\"http://localhost:8080\"' in the '[screenscraper]' section of config.ini. Every rom is found and gets the same generated media.");
+  parser.addHelpOption();
+  QCommandLineOption portOption("port", "Port to listen on.\n(Default is 8080)", "PORT", "8080");
+  QCommandLineOption latencyOption("latency", "Milliseconds added to every reply.\n(Default is 0)", "MS", "0");
+  QCommandLineOption maxThreadsOption("maxthreads", "Number of game requests handled at the same time. Game requests beyond this get the thread limit reply, media downloads don't count. Also reported to Skyscraper as the number of threads allowed for the user.\n(Default is 1)", "THREADS", "1");
+  QCommandLineOption quotaOption("quota", "Number of game requests before the daily quota reply is sent instead.\n(Default is 0, which is unlimited)", "REQUESTS", "0");
+  QCommandLineOption closeRateOption("closerate", "Percentage of requests where the connection is closed without a reply.\n(Default is 0)", "0-100", "0");
+  QCommandLineOption busyRateOption("busyrate", "Percentage of game requests that get the thread limit reply.\n(Default is 0)", "0-100", "0");
+  QCommandLineOption badJsonRateOption("badjsonrate", "Percentage of game requests that get a reply with the malformed JSON ScreenScraper sometimes sends, a comma after the last array of the game.\n(Default is 0)", "0-100", "0");
+  parser.addOption(portOption);
+  parser.addOption(latencyOption);
+  parser.addOption(maxThreadsOption);
+  parser.addOption(quotaOption);
+  parser.addOption(closeRateOption);
+  parser.addOption(busyRateOption);
+  parser.addOption(badJsonRateOption);
+  parser.process(app);
+
+  MockSettings settings;
+  settings.latency = qMax(parser.value(latencyOption).toInt(), 0);
+  settings.maxThreads = qMax(parser.value(maxThreadsOption).toInt(), 1);
+  settings.quota = qMax(parser.value(quotaOption).toInt(), 0);
+  settings.closeRate = qBound(0, parser.value(closeRateOption).toInt(), 100);
+  settings.busyRate = qBound(0, parser.value(busyRateOption).toInt(), 100);
+  settings.badJsonRate = qBound(0, parser.value(badJsonRateOption).toInt(), 100);
+
+  MockServer server(settings);
+  if(!server.listen(QHostAddress::Any, parser.value(portOption).toUShort())) {
+    printf("\033[1;31mCouldn't listen on port %s: %s\033[0m\n", parser.value(portOption).toStdString().c_str(), server.errorString().toStdString().c_str());
+    return 1;
+  }
+  printf("ScreenScraper stand-in listening on port \033[1;32m%d\033[0m\n", server.serverPort());
+  return app.exec();
+}
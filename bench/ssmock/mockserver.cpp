@@ -0,0 +1,259 @@
+/***************************************************************************
+ *            mockserver.cpp
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <QTimer>
+#include <QPointer>
+#include <QBuffer>
+#include <QImage>
+#include <QColor>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QCryptographicHash>
+#if QT_VERSION >= 0x050a00
+#include <QRandomGenerator>
+#endif
+
+#include "mockserver.h"
+
+// The text ScreenScraper sends instead of JSON when it is out of threads for a user
+static QByteArray getThreadLimitText()
+{
+  QByteArray text = "****";
+  for(const auto c: QByteArray("The maximum threads allowed to leecher users is already used")) {
+    text.append(c).append("****");
+  }
+  return text;
+}
+
+MockServer::MockServer(const MockSettings &settings)
+  : settings(settings)
+{
+  connect(this, &QTcpServer::newConnection, this, &MockServer::acceptConnection);
+}
+
+void MockServer::acceptConnection()
+{
+  while(hasPendingConnections()) {
+    QTcpSocket *socket = nextPendingConnection();
+    connect(socket, &QTcpSocket::readyRead, this, &MockServer::readRequest);
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+	buffers.remove(socket);
+	socket->deleteLater();
+      });
+  }
+}
+
+// Skyscraper only sends GET requests without a body, so a request ends with the empty line
+// after the headers. Connections are kept alive
+void MockServer::readRequest()
+{
+  QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+  QByteArray &buffer = buffers[socket];
+  buffer.append(socket->readAll());
+  int end = 0;
+  while((end = buffer.indexOf("\r\n\r\n")) != -1) {
+    QList<QByteArray> lines = buffer.left(end).split('\n');
+    buffer.remove(0, end + 4);
+    QByteArray path = lines.first().split(' ').value(1);
+    QByteArray host;
+    for(const auto &line: lines) {
+      if(line.toLower().startsWith("host:")) {
+	host = line.mid(5).trimmed();
+      }
+    }
+    handleRequest(socket, path, host);
+  }
+}
+
+void MockServer::handleRequest(QTcpSocket *socket, const QByteArray &path, const QByteArray &host)
+{
+  QUrl url = QUrl::fromEncoded(path);
+  QUrlQuery query(url);
+  QString endpoint = url.path();
+
+  int status = 200;
+  QByteArray contentType = "application/json";
+  QByteArray body;
+  bool close = roll(settings.closeRate);
+  // Only game requests count against the thread limit, like they do at ScreenScraper. Media
+  // downloads run next to them
+  bool game = (endpoint == "/api2/jeuInfos.php");
+  if(game) {
+    gamesInFlight++;
+    gameRequests++;
+    if(gamesInFlight > settings.maxThreads || roll(settings.busyRate)) {
+      status = 429;
+      contentType = "text/html";
+      body = getThreadLimitText();
+    } else if(settings.quota > 0 && gameRequests > settings.quota) {
+      status = 430;
+      contentType = "text/html";
+      body = "Votre quota de scrape est dépassé pour aujourd'hui !";
+    } else {
+      body = getGameInfo(query, host, roll(settings.badJsonRate));
+    }
+  } else if(endpoint == "/api2/ssuserInfos.php") {
+    body = getUserInfo(query);
+  } else if(endpoint == "/api2/mediaJeu.php") {
+    QString type = query.queryItemValue("media");
+    contentType = (type.startsWith("video")?"video/mp4":"image/png");
+    body = getMedia(type);
+  } else {
+    status = 404;
+    contentType = "text/html";
+    body = "Erreur : Rom/Iso/Dossier non trouvée !";
+  }
+
+  // The socket may be gone by the time the latency has passed
+  QPointer<QTcpSocket> target(socket);
+  QTimer::singleShot(settings.latency, this, [=]() {
+      if(game) {
+	gamesInFlight--;
+      }
+      if(target.isNull()) {
+	return;
+      }
+      if(close) {
+	// Skyscraper sees this as 'RemoteHostClosedError', like when ScreenScraper is overloaded
+	target->abort();
+	return;
+      }
+      sendReply(target, status, contentType, body);
+    });
+}
+
+void MockServer::sendReply(QTcpSocket *socket, const int &status, const QByteArray &contentType,
+			   const QByteArray &body)
+{
+  QByteArray reply = "HTTP/1.1 " + QByteArray::number(status) + (status == 200?" OK":" Error") + "\r\n";
+  reply.append("Content-Type: " + contentType + "\r\n");
+  reply.append("Content-Length: " + QByteArray::number(body.size()) + "\r\n");
+  reply.append("Connection: keep-alive\r\n\r\n");
+  reply.append(body);
+  socket->write(reply);
+}
+
+// A game with every resource the module reads. The title is the rom name without its extension
+QByteArray MockServer::getGameInfo(const QUrlQuery &query, const QByteArray &host,
+				   const bool &malformed)
+{
+  QString romName = query.queryItemValue("romnom", QUrl::FullyDecoded);
+  QString title = romName.left(romName.lastIndexOf('.') > 0?romName.lastIndexOf('.'):romName.length());
+  QString id = QString::number(qHash(romName) % 100000 + 1);
+  auto text = [](const QString &key, const QString &value, const QString &content) {
+    return QJsonObject({{key, value}, {"text", content}});
+  };
+
+  QJsonArray medias;
+  for(const auto &type: QStringList({"box-2D", "ss", "wheel", "screenmarquee", "video"})) {
+    QString mediaUrl = "http://" + host + "/api2/mediaJeu.php?systemeid=" +
+      query.queryItemValue("systemeid") + "&jeuid=" + id + "&media=" + type;
+    medias.append(QJsonObject({{"type", type}, {"region", "wor"}, {"url", mediaUrl},
+	    {"format", (type == "video"?"mp4":"png")}}));
+  }
+  QJsonObject game({
+      {"id", id},
+      {"noms", QJsonArray({text("region", "wor", title)})},
+      {"systeme", QJsonObject({{"id", query.queryItemValue("systemeid")}, {"text", "Mock"}})},
+      {"editeur", QJsonObject({{"text", "Mock Publisher"}})},
+      {"developpeur", QJsonObject({{"text", "Mock Developer"}})},
+      {"joueurs", QJsonObject({{"text", "1-2"}})},
+      {"note", QJsonObject({{"text", "15"}})},
+      {"synopsis", QJsonArray({text("langue", "en", "The game '" + title + "' as served by the ScreenScraper stand-in server.")})},
+      {"classifications", QJsonArray({text("type", "PEGI", "12")})},
+      {"dates", QJsonArray({text("region", "wor", "1990-01-01")})},
+      {"genres", QJsonArray({QJsonObject({{"noms", QJsonArray({text("langue", "en", "Action")})}})})},
+      {"medias", medias}
+    });
+  QByteArray jeu = QJsonDocument(game).toJson(QJsonDocument::Compact);
+  if(malformed) {
+    // ScreenScraper sometimes leaves a comma after the last array of the game, which makes the
+    // JSON invalid. Skyscraper repairs exactly this pattern before parsing
+    jeu.chop(1);
+    jeu.append(",\"roms\":[],\n\t\t}");
+  }
+  QJsonObject header({{"success", "true"}, {"error", ""}});
+  return "{\"header\":" + QJsonDocument(header).toJson(QJsonDocument::Compact) +
+    ",\"response\":{\"ssuser\":" + QJsonDocument(getUser(query)).toJson(QJsonDocument::Compact) +
+    ",\"jeu\":" + jeu + "}}";
+}
+
+// Skyscraper sets its number of threads from 'maxthreads' and stops when the requests of the day
+// reach 'maxrequestsperday'
+QJsonObject MockServer::getUser(const QUrlQuery &query)
+{
+  return QJsonObject({
+      {"id", query.queryItemValue("ssid")},
+      {"maxthreads", QString::number(settings.maxThreads)},
+      {"requeststoday", QString::number(gameRequests)},
+      {"maxrequestsperday", QString::number(settings.quota > 0?settings.quota:20000)}
+    });
+}
+
+QByteArray MockServer::getUserInfo(const QUrlQuery &query)
+{
+  QJsonObject reply({
+      {"header", QJsonObject({{"success", "true"}, {"error", ""}})},
+      {"response", QJsonObject({{"ssuser", getUser(query)}})}
+    });
+  return QJsonDocument(reply).toJson();
+}
+
+// The same media is sent for every game, so it's only generated once per type. Videos are just
+// random bytes of a realistic size
+QByteArray MockServer::getMedia(const QString &type)
+{
+  if(mediaData.contains(type)) {
+    return mediaData.value(type);
+  }
+  QByteArray data;
+  if(type.startsWith("video")) {
+    data.resize(2 * 1024 * 1024);
+    for(int a = 0; a < data.size(); ++a) {
+      data[a] = (char)(qHash(a) & 0xff);
+    }
+  } else {
+    QImage image(640, 480, QImage::Format_ARGB32);
+    image.fill(QColor::fromHsv(qHash(type) % 360, 160, 200));
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+  }
+  mediaData.insert(type, data);
+  return data;
+}
+
+bool MockServer::roll(const int &rate)
+{
+  if(rate <= 0) {
+    return false;
+  }
+#if QT_VERSION >= 0x050a00
+  return QRandomGenerator::global()->bounded(100) < rate;
+#else
+  return qrand() % 100 < rate;
+#endif
+}
@@ -0,0 +1,76 @@
+/***************************************************************************
+ *            mockserver.h
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#ifndef MOCKSERVER_H
+#define MOCKSERVER_H
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrlQuery>
+#include <QJsonObject>
+#include <QMap>
+
+struct MockSettings
+{
+  int latency = 0; // In ms, added to every reply
+  int maxThreads = 1; // Game requests handled at the same time before the thread limit reply is sent
+  int quota = 0; // Game requests before the quota reply is sent, 0 is unlimited
+  int closeRate = 0; // In percent, connections closed without a reply
+  int busyRate = 0; // In percent, thread limit replies on top of the ones from 'maxThreads'
+  int badJsonRate = 0; // In percent, game replies with the trailing comma ScreenScraper sometimes sends
+};
+
+// Answers the ScreenScraper requests Skyscraper sends with generated games and media. Every rom
+// name is found, and the faults ScreenScraper shows when it is overloaded can be switched on
+class MockServer : public QTcpServer
+{
+  Q_OBJECT
+
+public:
+  MockServer(const MockSettings &settings);
+
+private slots:
+  void acceptConnection();
+  void readRequest();
+
+private:
+  void handleRequest(QTcpSocket *socket, const QByteArray &path, const QByteArray &host);
+  void sendReply(QTcpSocket *socket, const int &status, const QByteArray &contentType,
+		 const QByteArray &body);
+  QByteArray getGameInfo(const QUrlQuery &query, const QByteArray &host, const bool &malformed);
+  QByteArray getUserInfo(const QUrlQuery &query);
+  QJsonObject getUser(const QUrlQuery &query);
+  QByteArray getMedia(const QString &type);
+  bool roll(const int &rate);
+
+  MockSettings settings;
+  QMap<QTcpSocket *, QByteArray> buffers;
+  QMap<QString, QByteArray> mediaData;
+  int gamesInFlight = 0;
+  int gameRequests = 0;
+
+};
+
+#endif // MOCKSERVER_H
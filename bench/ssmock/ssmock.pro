@@ -0,0 +1,16 @@
+# Stand-in for the ScreenScraper API, used for load testing the 'screenscraper' scraping module
+# without using up the quota of a real account. Build it with 'make ssmock' from the Skyscraper
+# build folder, or from this folder with 'qmake && make'. Then run './ssmock --help'.
+TEMPLATE = app
+TARGET = ssmock
+DEPENDPATH += .
+INCLUDEPATH += .
+CONFIG += release console
+CONFIG -= app_bundle
+QT += core gui network
+QMAKE_CXXFLAGS += -std=c++11
+
+HEADERS += mockserver.h
+
+SOURCES += main.cpp \
+           mockserver.cpp
@@ -4,7 +4,7 @@ DEPENDPATH += .
 INCLUDEPATH += .
 CONFIG += release
 win32:CONFIG += console
-QT += core network xml
+QT += core network xml concurrent
 QMAKE_CXXFLAGS += -std=c++11
 
 unix:target.path=/usr/local/bin
@@ -24,17 +24,24 @@ unix:resexamples.files=resources/maskexample.png resources/frameexample.png reso
 
 unix:INSTALLS += target examples cacheexamples impexamples resexamples
 
+# 'make ssmock' builds the stand-in ScreenScraper server in bench/ssmock for load testing
+ssmock.commands = cd $$PWD/bench/ssmock && $(QMAKE) ssmock.pro && $(MAKE)
+QMAKE_EXTRA_TARGETS += ssmock
+
 include(./VERSION)
 DEFINES+=VERSION=\\\"$$VERSION\\\"
 
 HEADERS += src/skyscraper.h \
            src/netmanager.h \
+           src/httpcache.h \
+           src/fixturestore.h \
            src/netcomm.h \
            src/xmlreader.h \
            src/settings.h \
            src/compositor.h \
            src/strtools.h \
            src/imgtools.h \
+           src/filetools.h \
            src/esgamelist.h \
            src/scraperworker.h \
            src/cache.h \
@@ -51,6 +58,7 @@ HEADERS += src/skyscraper.h \
            src/worldofspectrum.h \
            src/screenscraper.h \
            src/crc32.h \
+           src/digest.h \
            src/mobygames.h \
            src/igdb.h \
            src/arcadedb.h \
@@ -63,27 +71,25 @@ HEADERS += src/skyscraper.h \
            src/fxframe.h \
            src/fxrounded.h \
            src/fxstroke.h \
-           src/fxbrightness.h \
-           src/fxcontrast.h \
-           src/fxbalance.h \
-           src/fxopacity.h \
            src/fxgamebox.h \
-           src/fxhue.h \
-           src/fxsaturation.h \
-           src/fxcolorize.h \
            src/fxrotate.h \
            src/fxscanlines.h \
+           src/fxcolors.h \
+           src/boxblur.h \
            src/nametools.h \
            src/queue.h
 
 SOURCES += src/main.cpp \
            src/skyscraper.cpp \
            src/netmanager.cpp \
+           src/httpcache.cpp \
+           src/fixturestore.cpp \
            src/netcomm.cpp \
            src/xmlreader.cpp \
            src/compositor.cpp \
            src/strtools.cpp \
            src/imgtools.cpp \
+           src/filetools.cpp \
            src/esgamelist.cpp \
            src/scraperworker.cpp \
            src/cache.cpp \
@@ -100,6 +106,7 @@ SOURCES += src/main.cpp \
            src/worldofspectrum.cpp \
            src/screenscraper.cpp \
            src/crc32.cpp \
+           src/digest.cpp \
            src/mobygames.cpp \
            src/igdb.cpp \
            src/arcadedb.cpp \
@@ -112,15 +119,10 @@ SOURCES += src/main.cpp \
            src/fxframe.cpp \
            src/fxrounded.cpp \
            src/fxstroke.cpp \
-           src/fxbrightness.cpp \
-           src/fxcontrast.cpp \
-           src/fxbalance.cpp \
-           src/fxopacity.cpp \
            src/fxgamebox.cpp \
-           src/fxhue.cpp \
-           src/fxsaturation.cpp \
-           src/fxcolorize.cpp \
            src/fxrotate.cpp \
            src/fxscanlines.cpp \
+           src/fxcolors.cpp \
+           src/boxblur.cpp \
            src/nametools.cpp \
            src/queue.cpp
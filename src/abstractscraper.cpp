@@ -30,6 +30,9 @@
 
 #include <QRegularExpression>
 #include <QDomDocument>
+#include <QSet>
+#include <QFile>
+#include <QUuid>
 
 AbstractScraper::AbstractScraper(Settings *config,
 				 QSharedPointer<NetManager> manager)
@@ -135,6 +138,7 @@ void AbstractScraper::getGameData(GameEntry &game)
       ;
     }
   }
+  fetchMedia(game);
 }
 
 void AbstractScraper::getDescription(GameEntry &game)
@@ -274,7 +278,7 @@ void AbstractScraper::getReleaseDate(GameEntry &game)
   game.releaseDate = data.left(data.indexOf(releaseDatePost.toUtf8())).simplified();
 }
 
-void AbstractScraper::getCover(GameEntry &game)
+void AbstractScraper::getCover(GameEntry &)
 {
   if(coverPre.isEmpty()) {
     return;
@@ -291,16 +295,10 @@ void AbstractScraper::getCover(GameEntry &game)
   if(coverUrl.left(4) != "http") {
     coverUrl.prepend(baseUrl + (coverUrl.left(1) == "/"?"":"/"));
   }
-  netComm->request(coverUrl);
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.coverData = netComm->getData();
-  }
+  addMediaRequest(COVER, coverUrl);
 }
 
-void AbstractScraper::getScreenshot(GameEntry &game)
+void AbstractScraper::getScreenshot(GameEntry &)
 {
   if(screenshotPre.isEmpty()) {
     return;
@@ -317,17 +315,11 @@ void AbstractScraper::getScreenshot(GameEntry &game)
     if(screenshotUrl.left(4) != "http") {
       screenshotUrl.prepend(baseUrl + (screenshotUrl.left(1) == "/"?"":"/"));
     }
-    netComm->request(screenshotUrl);
-    q.exec();
-    QImage image;
-    if(netComm->getError() == QNetworkReply::NoError &&
-       image.loadFromData(netComm->getData())) {
-      game.screenshotData = netComm->getData();
-    }
+    addMediaRequest(SCREENSHOT, screenshotUrl);
   }
 }
 
-void AbstractScraper::getWheel(GameEntry &game)
+void AbstractScraper::getWheel(GameEntry &)
 {
   if(wheelPre.isEmpty()) {
     return;
@@ -344,16 +336,10 @@ void AbstractScraper::getWheel(GameEntry &game)
   if(wheelUrl.left(4) != "http") {
     wheelUrl.prepend(baseUrl + (wheelUrl.left(1) == "/"?"":"/"));
   }
-  netComm->request(wheelUrl);
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.wheelData = netComm->getData();
-  }
+  addMediaRequest(WHEEL, wheelUrl);
 }
 
-void AbstractScraper::getMarquee(GameEntry &game)
+void AbstractScraper::getMarquee(GameEntry &)
 {
   if(marqueePre.isEmpty()) {
     return;
@@ -370,16 +356,10 @@ void AbstractScraper::getMarquee(GameEntry &game)
   if(marqueeUrl.left(4) != "http") {
     marqueeUrl.prepend(baseUrl + (marqueeUrl.left(1) == "/"?"":"/"));
   }
-  netComm->request(marqueeUrl);
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.marqueeData = netComm->getData();
-  }
+  addMediaRequest(MARQUEE, marqueeUrl);
 }
 
-void AbstractScraper::getVideo(GameEntry &game)
+void AbstractScraper::getVideo(GameEntry &)
 {
   if(videoPre.isEmpty()) {
     return;
@@ -396,12 +376,7 @@ void AbstractScraper::getVideo(GameEntry &game)
   if(videoUrl.left(4) != "http") {
     videoUrl.prepend(baseUrl + (videoUrl.left(1) == "/"?"":"/"));
   }
-  netComm->request(videoUrl);
-  q.exec();
-  if(netComm->getError() == QNetworkReply::NoError) {
-    game.videoData = netComm->getData();
-    game.videoFormat = videoUrl.right(3);
-  }
+  addMediaRequest(VIDEO, videoUrl, videoUrl.right(3));
 }
 
 void AbstractScraper::nomNom(const QString nom, bool including)
@@ -417,6 +392,123 @@ bool AbstractScraper::checkNom(const QString nom)
   return false;
 }
 
+// Media is only collected while getting the game data, fetchMedia() then downloads all of it at once
+void AbstractScraper::addMediaRequest(const int &type, const QString &url, const QString &videoFormat,
+				      const QString &fallbackUrl)
+{
+  MediaRequest media;
+  media.type = type;
+  media.url = url;
+  media.videoFormat = videoFormat;
+  media.fallbackUrl = fallbackUrl;
+  mediaRequests.append(media);
+}
+
+// Downloads all collected media concurrently. Requests that fail are retried together in the next
+// round, or replaced by their fallback url if they have one. If several urls are added for the
+// same type, the first valid one in order of adding wins
+void AbstractScraper::fetchMedia(GameEntry &game, const int &retries, const int &minSize)
+{
+  QList<MediaRequest> pending = mediaRequests;
+  mediaRequests.clear();
+  QSet<int> done;
+  while(!pending.isEmpty()) {
+    QList<BatchRequest> batch;
+    for(const auto &media: pending) {
+      BatchRequest batchRequest;
+      batchRequest.url = media.url;
+      // Videos can be huge, so they go straight to disk and are handed to the cache as files
+      if(media.type == VIDEO && !config->cacheFolder.isEmpty()) {
+	batchRequest.fileName = config->cacheFolder + "/downloads/" + QUuid::createUuid().toString().mid(1, 36);
+      }
+      batch.append(batchRequest);
+    }
+    netComm->requestBatch(batch);
+    for(int a = 0; a < pending.length(); ++a) {
+      if(!done.contains(pending.at(a).type) &&
+	 setMedia(game, pending.at(a), batch.at(a), minSize)) {
+	done.insert(pending.at(a).type);
+      }
+      // Remove downloads that were invalid or lost to an earlier url of the same type
+      if(!batch.at(a).fileName.isEmpty() &&
+	 batch.at(a).fileName != game.getMediaFile(VIDEO)) {
+	QFile::remove(batch.at(a).fileName);
+      }
+    }
+    QList<MediaRequest> failed;
+    for(auto media: pending) {
+      if(done.contains(media.type)) {
+	continue;
+      }
+      media.attempts++;
+      if(!media.fallbackUrl.isEmpty()) {
+	media.url = media.fallbackUrl;
+	media.fallbackUrl.clear();
+	media.attempts = 0;
+      }
+      if(media.attempts < retries) {
+	failed.append(media);
+      }
+    }
+    pending = failed;
+  }
+}
+
+bool AbstractScraper::setMedia(GameEntry &game, const MediaRequest &media,
+			       const BatchRequest &result, const int &minSize)
+{
+  if(result.error != QNetworkReply::NoError) {
+    NetComm::printError(result.error, config->verbosity);
+    return false;
+  }
+  if(result.size < minSize) {
+    return false;
+  }
+  if(media.type == VIDEO) {
+    // Make sure received data is actually a video file
+    QString videoFormat = media.videoFormat;
+    if(videoFormat.isEmpty()) {
+      if(!result.contentType.contains("video/")) {
+	return false;
+      }
+      videoFormat = result.contentType.mid(result.contentType.indexOf("/") + 1);
+    }
+    if(result.size <= 4096) {
+      return false;
+    }
+    if(result.fileName.isEmpty()) {
+      game.videoData = result.data;
+    } else {
+      game.setMediaFile(VIDEO, result.fileName);
+    }
+    game.videoFormat = videoFormat;
+    return true;
+  }
+  QImage image;
+  if(!image.loadFromData(result.data)) {
+    return false;
+  }
+  if(media.type == COVER) {
+    game.coverData = result.data;
+  } else if(media.type == SCREENSHOT) {
+    game.screenshotData = result.data;
+  } else if(media.type == WHEEL) {
+    game.wheelData = result.data;
+  } else if(media.type == MARQUEE) {
+    game.marqueeData = result.data;
+  }
+  return true;
+}
+
+// Users can lower the request rate of a module with 'requestsPerSecond', but never raise it
+double AbstractScraper::getRequestRate(const double &maxRate)
+{
+  if(config->requestsPerSecond > 0.0 && config->requestsPerSecond < maxRate) {
+    return config->requestsPerSecond;
+  }
+  return maxRate;
+}
+
 QList<QString> AbstractScraper::getSearchNames(const QFileInfo &info)
 {
   QString baseName = info.completeBaseName();
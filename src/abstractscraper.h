@@ -36,6 +36,15 @@
 #include <QFileInfo>
 #include <QSettings>
 
+struct MediaRequest
+{
+  int type;
+  QString url;
+  QString videoFormat;
+  QString fallbackUrl; // Only requested if 'url' fails
+  int attempts = 0;
+};
+
 class AbstractScraper : public QObject
 {
   Q_OBJECT
@@ -78,6 +87,13 @@ protected:
   virtual QString getPlatformId(const QString);
 
   bool checkNom(const QString nom);
+  double getRequestRate(const double &maxRate);
+
+  void addMediaRequest(const int &type, const QString &url, const QString &videoFormat = QString(),
+		       const QString &fallbackUrl = QString());
+  void fetchMedia(GameEntry &game, const int &retries = 1, const int &minSize = 0);
+  bool setMedia(GameEntry &game, const MediaRequest &media, const BatchRequest &result, const int &minSize);
+  QList<MediaRequest> mediaRequests;
 
   QList<int> fetchOrder;
 
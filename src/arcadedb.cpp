@@ -129,6 +129,7 @@ void ArcadeDB::getGameData(GameEntry &game)
       ;
     }
   }
+  fetchMedia(game);
 }
 
 void ArcadeDB::getReleaseDate(GameEntry &game)
@@ -159,84 +160,48 @@ void ArcadeDB::getDescription(GameEntry &game)
   }
 }
 
-void ArcadeDB::getCover(GameEntry &game)
+void ArcadeDB::getCover(GameEntry &)
 {
-  for(const auto &key: jsonObj.keys()) {
-    if(key == "url_image_flyer" ||
-       key == "url_image_title") {
-      if(jsonObj.value(key).toString().isEmpty()) {
-	continue;
-      }
-      netComm->request(jsonObj.value(key).toString());
-      q.exec();
-      {
-	QImage image;
-	if(netComm->getError() == QNetworkReply::NoError &&
-	   image.loadFromData(netComm->getData())) {
-	  game.coverData = netComm->getData();
-	  return;
-	}
-      }
-    }
+  // The title image is only downloaded if there's no usable flyer
+  QString flyer = jsonObj.value("url_image_flyer").toString();
+  QString title = jsonObj.value("url_image_title").toString();
+  if(!flyer.isEmpty()) {
+    addMediaRequest(COVER, flyer, QString(), title);
+  } else if(!title.isEmpty()) {
+    addMediaRequest(COVER, title);
   }
 }
 
-void ArcadeDB::getScreenshot(GameEntry &game)
+void ArcadeDB::getScreenshot(GameEntry &)
 {
   if(!jsonObj.contains("url_image_ingame") ||
      jsonObj.value("url_image_ingame").toString().isEmpty()) {
     return;
   }
-  netComm->request(jsonObj.value("url_image_ingame").toString());
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.screenshotData = netComm->getData();
-  }
+  addMediaRequest(SCREENSHOT, jsonObj.value("url_image_ingame").toString());
 }
 
-void ArcadeDB::getWheel(GameEntry &game)
+void ArcadeDB::getWheel(GameEntry &)
 {
-  netComm->request("http://adb.arcadeitalia.net/media/mame.current/decals/" + jsonObj["game_name"].toString() + ".png");
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.wheelData = netComm->getData();
-  }
+  addMediaRequest(WHEEL, "http://adb.arcadeitalia.net/media/mame.current/decals/" + jsonObj["game_name"].toString() + ".png");
 }
 
-void ArcadeDB::getMarquee(GameEntry &game)
+void ArcadeDB::getMarquee(GameEntry &)
 {
   if(!jsonObj.contains("url_image_marquee") ||
      jsonObj.value("url_image_marquee").toString().isEmpty()) {
     return;
   }
-  netComm->request(jsonObj.value("url_image_marquee").toString());
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.marqueeData = netComm->getData();
-  }
+  addMediaRequest(MARQUEE, jsonObj.value("url_image_marquee").toString());
 }
 
-void ArcadeDB::getVideo(GameEntry &game)
+void ArcadeDB::getVideo(GameEntry &)
 {
   if(!jsonObj.contains("url_video_shortplay") ||
      jsonObj.value("url_video_shortplay").toString().isEmpty()) {
     return;
   }
-  netComm->request(jsonObj.value("url_video_shortplay").toString());
-  q.exec();
-  game.videoData = netComm->getData();
-  if(netComm->getError() == QNetworkReply::NoError &&
-     game.videoData.length() > 4096) {
-    game.videoFormat = "mp4";
-  } else {
-    game.videoData = "";
-  }
+  addMediaRequest(VIDEO, jsonObj.value("url_video_shortplay").toString(), "mp4");
 }
 
 QList<QString> ArcadeDB::getSearchNames(const QFileInfo &info)
@@ -0,0 +1,292 @@
+/***************************************************************************
+ *            boxblur.cpp
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <cmath>
+#include <cstring>
+
+#include <QThread>
+#include <QtConcurrent>
+#include <QAtomicInt>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "boxblur.h"
+
+// Images with fewer pixels than this are blurred on the calling thread only
+constexpr int PARALLELPIXELS = 256 * 256;
+// Side length in pixels of the blocks the transpose works on
+constexpr int TILESIZE = 16;
+
+// Blurs running right now on any thread. They share the cores between their bands
+static QAtomicInt activeBlurs;
+
+// Blurs run inside the compositing pool, so their bands get a pool of their own instead of the
+// global one. The calling thread always takes a band as well. Never deleted, as it has to
+// outlive any compositing threads that are still finishing up when the program exits
+static QThreadPool *getBandPool()
+{
+  static QThreadPool *bandPool = []() {
+    QThreadPool *pool = new QThreadPool;
+    pool->setMaxThreadCount(qMax(QThread::idealThreadCount() - 1, 1));
+    return pool;
+  }();
+  return bandPool;
+}
+
+void BoxBlur::boxBlur(QImage &image, const int &radius)
+{
+  blur(image, QVector<int>(1, radius));
+}
+
+// Three box blurs in a row approximate a gaussian blur. Sigma is chosen so the three boxes
+// together reach about as far as a single box with the same radius
+void BoxBlur::gaussianBlur(QImage &image, const int &radius)
+{
+  QVector<int> radii;
+  for(const auto &size: getGaussBoxes(radius / 3.0, 3)) {
+    radii.append((size - 1) / 2);
+  }
+  blur(image, radii);
+}
+
+// Returns the sizes of 'n' boxes that together approximate a gaussian with the given sigma
+QVector<int> BoxBlur::getGaussBoxes(const double &sigma, const int &n)
+{
+  double wIdeal = sqrt((12.0 * sigma * sigma / n) + 1.0);
+  int wl = floor(wIdeal);
+  if(wl % 2 == 0) {
+    wl--;
+  }
+  int wu = wl + 2;
+  double mIdeal = (12.0 * sigma * sigma - n * wl * wl - 4.0 * n * wl - 3.0 * n) / (-4.0 * wl - 4.0);
+  int m = round(mIdeal);
+
+  QVector<int> sizes;
+  for(int i = 0; i < n; i++) {
+    sizes.append(i < m?wl:wu);
+  }
+  return sizes;
+}
+
+void BoxBlur::blur(QImage &image, const QVector<int> &radii)
+{
+  if(image.isNull()) {
+    return;
+  }
+  if(image.format() != QImage::Format_ARGB32_Premultiplied) {
+    image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+  }
+  int width = image.width(), height = image.height();
+  QRgb *bits = (QRgb *)image.bits();
+  QImage transposed(height, width, QImage::Format_ARGB32_Premultiplied);
+  QRgb *transposedBits = (QRgb *)transposed.bits();
+
+  activeBlurs.ref();
+  blurRows(bits, width, height, radii);
+  transpose(bits, transposedBits, width, height);
+  blurRows(transposedBits, height, width, radii);
+  transpose(transposedBits, bits, height, width);
+  activeBlurs.deref();
+}
+
+// Runs all passes on a row while it is in the cache before moving on to the next
+void BoxBlur::blurRows(QRgb *bits, const int &width, const int &height, const QVector<int> &radii)
+{
+  forBands(height, width, [&](int first, int last) {
+      QVector<QRgb> line1(width), line2(width);
+      QRgb *src = line1.data(), *dst = line2.data();
+      for(int y = first; y < last; ++y) {
+	QRgb *row = bits + y * width;
+	memcpy(src, row, width * sizeof(QRgb));
+	for(const auto &radius: radii) {
+	  if(radius > 0) {
+	    blurLine(src, dst, width, radius);
+	    std::swap(src, dst);
+	  }
+	}
+	memcpy(row, src, width * sizeof(QRgb));
+      }
+    });
+}
+
+// Sliding window over a single row. Pixels outside the row repeat the edge pixels. Every
+// output is the rounded window average, using a multiplication by the reciprocal of the window
+// size instead of a division. The window size is odd, so (sum + span / 2) / span never lands
+// exactly on an integer and float precision is plenty for the truncation to round correctly
+void BoxBlur::blurLine(const QRgb *src, QRgb *dst, const int &width, const int &radius)
+{
+  int span = radius + radius + 1;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  auto unpack = [&zero](const QRgb &pixel) {
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero), zero);
+  };
+  const __m128 half = _mm_set1_ps(span * 0.5f);
+  const __m128 inverse = _mm_set1_ps(1.0f / span);
+  __m128i sum = zero;
+  for(int x = -radius; x <= radius; ++x) {
+    sum = _mm_add_epi32(sum, unpack(src[qBound(0, x, width - 1)]));
+  }
+  for(int x = 0; x < width; ++x) {
+    __m128i value = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(sum), half), inverse));
+    value = _mm_packs_epi32(value, value);
+    dst[x] = _mm_cvtsi128_si32(_mm_packus_epi16(value, value));
+    sum = _mm_add_epi32(sum, _mm_sub_epi32(unpack(src[qMin(x + radius + 1, width - 1)]),
+					   unpack(src[qMax(x - radius, 0)])));
+  }
+#elif defined(__ARM_NEON)
+  auto unpack = [](const QRgb &pixel) {
+    return vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(pixel)))));
+  };
+  const float32x4_t half = vdupq_n_f32(span * 0.5f);
+  const float32x4_t inverse = vdupq_n_f32(1.0f / span);
+  uint32x4_t sum = vdupq_n_u32(0);
+  for(int x = -radius; x <= radius; ++x) {
+    sum = vaddq_u32(sum, unpack(src[qBound(0, x, width - 1)]));
+  }
+  for(int x = 0; x < width; ++x) {
+    uint32x4_t value = vcvtq_u32_f32(vmulq_f32(vaddq_f32(vcvtq_f32_u32(sum), half), inverse));
+    uint16x4_t narrow = vmovn_u32(value);
+    dst[x] = vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(narrow, narrow))), 0);
+    sum = vaddq_u32(sum, vsubq_u32(unpack(src[qMin(x + radius + 1, width - 1)]),
+				   unpack(src[qMax(x - radius, 0)])));
+  }
+#else
+  const float half = span * 0.5f;
+  const float inverse = 1.0f / span;
+  int sumR = 0, sumG = 0, sumB = 0, sumA = 0;
+  for(int x = -radius; x <= radius; ++x) {
+    QRgb pixel = src[qBound(0, x, width - 1)];
+    sumR += qRed(pixel);
+    sumG += qGreen(pixel);
+    sumB += qBlue(pixel);
+    sumA += qAlpha(pixel);
+  }
+  for(int x = 0; x < width; ++x) {
+    dst[x] = qRgba((int)((sumR + half) * inverse), (int)((sumG + half) * inverse),
+		   (int)((sumB + half) * inverse), (int)((sumA + half) * inverse));
+    QRgb front = src[qMin(x + radius + 1, width - 1)];
+    QRgb back = src[qMax(x - radius, 0)];
+    sumR += qRed(front) - qRed(back);
+    sumG += qGreen(front) - qGreen(back);
+    sumB += qBlue(front) - qBlue(back);
+    sumA += qAlpha(front) - qAlpha(back);
+  }
+#endif
+}
+
+// Copies 'src' into 'dst' with rows and columns swapped. Works on square tiles so both the
+// reads and the writes stay within a few cache lines at a time
+void BoxBlur::transpose(const QRgb *src, QRgb *dst, const int &width, const int &height)
+{
+  int tileRows = (height + TILESIZE - 1) / TILESIZE;
+  forBands(tileRows, width * TILESIZE, [&](int first, int last) {
+      for(int tileY = first * TILESIZE; tileY < qMin(last * TILESIZE, height); tileY += TILESIZE) {
+	int endY = qMin(tileY + TILESIZE, height);
+	for(int tileX = 0; tileX < width; tileX += TILESIZE) {
+	  int endX = qMin(tileX + TILESIZE, width);
+	  int y = tileY;
+#if defined(__SSE2__) || defined(__ARM_NEON)
+	  // Blocks of 4x4 pixels are transposed in registers
+	  for(; y + 4 <= endY; y += 4) {
+	    int x = tileX;
+	    for(; x + 4 <= endX; x += 4) {
+#if defined(__SSE2__)
+	      __m128i row0 = _mm_loadu_si128((const __m128i *)(src + y * width + x));
+	      __m128i row1 = _mm_loadu_si128((const __m128i *)(src + (y + 1) * width + x));
+	      __m128i row2 = _mm_loadu_si128((const __m128i *)(src + (y + 2) * width + x));
+	      __m128i row3 = _mm_loadu_si128((const __m128i *)(src + (y + 3) * width + x));
+	      __m128i low01 = _mm_unpacklo_epi32(row0, row1);
+	      __m128i low23 = _mm_unpacklo_epi32(row2, row3);
+	      __m128i high01 = _mm_unpackhi_epi32(row0, row1);
+	      __m128i high23 = _mm_unpackhi_epi32(row2, row3);
+	      _mm_storeu_si128((__m128i *)(dst + x * height + y), _mm_unpacklo_epi64(low01, low23));
+	      _mm_storeu_si128((__m128i *)(dst + (x + 1) * height + y), _mm_unpackhi_epi64(low01, low23));
+	      _mm_storeu_si128((__m128i *)(dst + (x + 2) * height + y), _mm_unpacklo_epi64(high01, high23));
+	      _mm_storeu_si128((__m128i *)(dst + (x + 3) * height + y), _mm_unpackhi_epi64(high01, high23));
+#else
+	      uint32x4x2_t rows01 = vtrnq_u32(vld1q_u32(src + y * width + x),
+					      vld1q_u32(src + (y + 1) * width + x));
+	      uint32x4x2_t rows23 = vtrnq_u32(vld1q_u32(src + (y + 2) * width + x),
+					      vld1q_u32(src + (y + 3) * width + x));
+	      vst1q_u32(dst + x * height + y,
+			vcombine_u32(vget_low_u32(rows01.val[0]), vget_low_u32(rows23.val[0])));
+	      vst1q_u32(dst + (x + 1) * height + y,
+			vcombine_u32(vget_low_u32(rows01.val[1]), vget_low_u32(rows23.val[1])));
+	      vst1q_u32(dst + (x + 2) * height + y,
+			vcombine_u32(vget_high_u32(rows01.val[0]), vget_high_u32(rows23.val[0])));
+	      vst1q_u32(dst + (x + 3) * height + y,
+			vcombine_u32(vget_high_u32(rows01.val[1]), vget_high_u32(rows23.val[1])));
+#endif
+	    }
+	    for(; x < endX; ++x) {
+	      for(int a = 0; a < 4; ++a) {
+		dst[x * height + y + a] = src[(y + a) * width + x];
+	      }
+	    }
+	  }
+#endif
+	  for(; y < endY; ++y) {
+	    for(int x = tileX; x < endX; ++x) {
+	      dst[x * height + y] = src[y * width + x];
+	    }
+	  }
+	}
+      }
+    });
+}
+
+// Splits 'count' rows of 'length' pixels into bands and runs 'function' on each band in
+// parallel. A single blur gets one band per core. Blurs running at the same time split the cores
+// between them, so a game list run that already keeps every core busy with outputs doesn't put
+// another thread per core on top. The calling thread takes the first band itself
+void BoxBlur::forBands(const int &count, const int &length,
+		       const std::function<void(int, int)> &function)
+{
+  int bands = 1;
+  if((qint64)count * length >= PARALLELPIXELS) {
+    bands = qMin(QThread::idealThreadCount() / qMax(activeBlurs.load(), 1), count);
+  }
+  if(bands <= 1) {
+    function(0, count);
+    return;
+  }
+  QList<QFuture<void> > futures;
+  for(int band = 1; band < bands; ++band) {
+    int first = count * band / bands;
+    int last = count * (band + 1) / bands;
+    futures.append(QtConcurrent::run(getBandPool(), [&function, first, last]() {
+	  function(first, last);
+	}));
+  }
+  function(0, count / bands);
+  for(auto &future: futures) {
+    future.waitForFinished();
+  }
+}
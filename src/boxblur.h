@@ -0,0 +1,54 @@
+/***************************************************************************
+ *            boxblur.h
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#ifndef BOXBLUR_H
+#define BOXBLUR_H
+
+#include <functional>
+
+#include <QImage>
+#include <QVector>
+
+// Separable box blur used by the blur and shadow effects. Rows are blurred with a sliding
+// window that sums all four channels at once, and columns are blurred as rows of a transposed
+// copy of the image. Large images are split into bands of rows that are blurred in parallel
+class BoxBlur
+{
+public:
+  static void boxBlur(QImage &image, const int &radius);
+  static void gaussianBlur(QImage &image, const int &radius);
+  static QVector<int> getGaussBoxes(const double &sigma, const int &n);
+
+private:
+  static void blur(QImage &image, const QVector<int> &radii);
+  static void blurRows(QRgb *bits, const int &width, const int &height, const QVector<int> &radii);
+  static void blurLine(const QRgb *src, QRgb *dst, const int &width, const int &radius);
+  static void transpose(const QRgb *src, QRgb *dst, const int &width, const int &height);
+  static void forBands(const int &count, const int &length,
+		       const std::function<void(int, int)> &function);
+
+};
+
+#endif // BOXBLUR_H
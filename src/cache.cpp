@@ -24,6 +24,8 @@
  */
 
 #include <iostream>
+#include <cstring>
+#include <algorithm>
 
 #include <QFile>
 #include <QDir>
@@ -34,16 +36,62 @@
 #include <QRegularExpression>
 #include <QBuffer>
 #include <QProcess>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QtEndian>
+#include <QtConcurrent>
+#include <QAtomicInt>
+#include <QCryptographicHash>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "cache.h"
 #include "nametools.h"
 #include "queue.h"
+#include "filetools.h"
+
+// db.bin layout, all integers little endian:
+// Header: magic, version, string count, record count, reserved, blob size
+// String table: string count * (offset, length) into the UTF-8 blob
+// Records: record count * (cacheId, type, source, value string indices + timestamp)
+// Blob: all UTF-8 string data
+// Records belonging to the same cache id are always stored consecutively.
+constexpr char BINMAGIC[] = "SKYSCRDB";
+constexpr quint32 BINVERSION = 1;
+constexpr int BINHEADERSIZE = 32;
+constexpr int BINSTRINGSIZE = 8;
+constexpr int BINRECORDSIZE = 24;
+
+// db.journal is a QDataStream with a magic and version header followed by one
+// record per added resource: cacheId, type, source, value and timestamp.
+constexpr quint32 JOURNALMAGIC = 0x534b594a;
+constexpr quint32 JOURNALVERSION = 1;
+constexpr int JOURNALSYNCINTERVAL = 50; // fsync the journal every N appended resources
+constexpr int JOURNALCOMPACTPERCENT = 10; // Fold journal into db when it holds more than this
+
+// quickid.dat is a QDataStream with a magic and version header, an entry count and then
+// device, inode, size, modification time and cacheId for each entry.
+constexpr quint32 QUICKIDMAGIC = 0x534b5951;
+constexpr quint32 QUICKIDVERSION = 1;
 
 Cache::Cache(const QString &cacheFolder)
 {
   cacheDir = QDir(cacheFolder);
 }
 
+Cache::~Cache()
+{
+  if(journalFile.isOpen()) {
+    syncJournal();
+    journalFile.close();
+  }
+  closeBinary();
+}
+
 bool Cache::createFolders(const QString &scraper)
 {
   if(scraper != "cache") {
@@ -62,6 +110,16 @@ bool Cache::createFolders(const QString &scraper)
     if(!cacheDir.mkpath(cacheDir.absolutePath() + "/videos/" + scraper)) {
       return false;
     }
+    // Videos are downloaded here before being moved into place. Anything left over is from an
+    // interrupted run
+    QDir downloadsDir(cacheDir.absolutePath() + "/downloads");
+    if(downloadsDir.exists()) {
+      for(const auto &leftover: downloadsDir.entryList(QDir::Files)) {
+	downloadsDir.remove(leftover);
+      }
+    } else if(!cacheDir.mkpath(downloadsDir.absolutePath())) {
+      return false;
+    }
   }
 
   // Copy priorities.xml example file to cache folder if it doesn't already exist
@@ -75,35 +133,134 @@ bool Cache::createFolders(const QString &scraper)
 
 bool Cache::read()
 {
-  QFile quickIdFile(cacheDir.absolutePath() + "/quickid.xml");
-  if(quickIdFile.open(QIODevice::ReadOnly)) {
-    printf("Reading and parsing quick id xml, please wait... ");
-    fflush(stdout);
-    QXmlStreamReader xml(&quickIdFile);
-    while(!xml.atEnd()) {
-      if(xml.readNext() != QXmlStreamReader::StartElement) {
-	continue;
-      }
-      if(xml.name() != "quickid") {
-	continue;
-      }
-      QXmlStreamAttributes attribs = xml.attributes();
-      if(!attribs.hasAttribute("filepath") ||
-	 !attribs.hasAttribute("timestamp") ||
-	 !attribs.hasAttribute("id")) {
-	continue;
-      }
+  if(QFileInfo::exists(cacheDir.absolutePath() + "/quickid.dat")) {
+    readQuickIds();
+  } else {
+    readLegacyQuickIds();
+  }
+
+  // If both database formats exist, the most recently modified one is used. An older binary
+  // version or a hand edited db.xml would otherwise be silently ignored
+  QFileInfo binInfo(cacheDir.absolutePath() + "/db.bin");
+  QFileInfo xmlInfo(cacheDir.absolutePath() + "/db.xml");
+  bool useBinary = binInfo.exists();
+  if(binInfo.exists() && xmlInfo.exists()) {
+    useBinary = (binInfo.lastModified() >= xmlInfo.lastModified());
+    printf("\033[1;33mFound both 'db.bin' and 'db.xml', using the newer '%s'. Use '--cache convert' or '--cache convert:xml' to keep only one of them.\033[0m\n",
+	   (useBinary?"db.bin":"db.xml"));
+  }
 
-      QPair<qint64, QString> pair;
-      pair.first = attribs.value("timestamp").toULongLong();
-      pair.second = attribs.value("id").toString();
-      quickIds[attribs.value("filepath").toString()] = pair;
+  bool result = false;
+  if(useBinary) {
+    if(!readBinary()) {
+      printf("Please move or remove '%s' and try again. Now quitting...\n",
+	     (cacheDir.absolutePath() + "/db.bin").toStdString().c_str());
+      exit(1);
     }
-    printf("\033[1;32mDone!\033[0m\n");
+    result = true;
+  } else {
+    result = readXml();
+  }
+  if(replayJournal()) {
+    result = true;
+  }
+  return result;
+}
+
+void Cache::readQuickIds()
+{
+  QFile quickIdFile(cacheDir.absolutePath() + "/quickid.dat");
+  if(!quickIdFile.open(QIODevice::ReadOnly)) {
+    return;
+  }
+  printf("Reading quick id index, please wait... ");
+  fflush(stdout);
+  QDataStream in(&quickIdFile);
+  in.setVersion(QDataStream::Qt_5_0);
+  quint32 magic = 0;
+  quint32 version = 0;
+  quint32 entries = 0;
+  in >> magic >> version >> entries;
+  if(magic != QUICKIDMAGIC || version != QUICKIDVERSION) {
+    printf("\033[1;33mUnknown format, ignoring it!\033[0m\n");
+    return;
+  }
+  quickIds.reserve(entries);
+  for(quint32 a = 0; a < entries && in.status() == QDataStream::Ok; ++a) {
+    QuickIdKey key;
+    QString cacheId;
+    in >> key.device >> key.inode >> key.size >> key.modified >> cacheId;
+    if(in.status() == QDataStream::Ok) {
+      insertQuickId(key, cacheId);
+    }
+  }
+  printf("\033[1;32mDone!\033[0m\n");
+}
+
+// Converts the path based quickid.xml from older versions. Entries for files that no
+// longer exist or have changed since they were hashed are dropped
+void Cache::readLegacyQuickIds()
+{
+  QFile quickIdFile(cacheDir.absolutePath() + "/quickid.xml");
+  if(!quickIdFile.open(QIODevice::ReadOnly)) {
+    return;
+  }
+  printf("Converting quick id xml, please wait... ");
+  fflush(stdout);
+  QXmlStreamReader xml(&quickIdFile);
+  while(!xml.atEnd()) {
+    if(xml.readNext() != QXmlStreamReader::StartElement) {
+      continue;
+    }
+    if(xml.name() != "quickid") {
+      continue;
+    }
+    QXmlStreamAttributes attribs = xml.attributes();
+    if(!attribs.hasAttribute("filepath") ||
+       !attribs.hasAttribute("timestamp") ||
+       !attribs.hasAttribute("id")) {
+      continue;
+    }
+    QFileInfo info(attribs.value("filepath").toString());
+    if(info.exists() &&
+       info.lastModified().toMSecsSinceEpoch() <= attribs.value("timestamp").toLongLong()) {
+      addQuickId(info, attribs.value("id").toString());
+    }
+  }
+  printf("\033[1;32mDone!\033[0m\n");
+}
+
+bool Cache::writeQuickIds()
+{
+  QSaveFile quickIdFile(cacheDir.absolutePath() + "/quickid.dat");
+  if(!quickIdFile.open(QIODevice::WriteOnly)) {
+    return false;
   }
+  printf("Writing quick id index, please wait... ");
+  fflush(stdout);
+  QDataStream out(&quickIdFile);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << QUICKIDMAGIC << QUICKIDVERSION << (quint32)quickIds.size();
+  for(QHash<QuickIdKey, QString>::const_iterator it = quickIds.constBegin();
+      it != quickIds.constEnd(); ++it) {
+    out << it.key().device << it.key().inode << it.key().size << it.key().modified << it.value();
+  }
+  if(out.status() != QDataStream::Ok || !quickIdFile.commit()) {
+    printf("\033[1;31mFailed!\033[0m\n");
+    return false;
+  }
+  // The index replaces quickid.xml from older versions
+  QFile::remove(cacheDir.absolutePath() + "/quickid.xml");
+  printf("\033[1;32mDone!\033[0m\n");
+  return true;
+}
 
+bool Cache::readXml()
+{
   QFile cacheFile(cacheDir.absolutePath() + "/db.xml");
   if(cacheFile.open(QIODevice::ReadOnly)) {
+    // Existing xml caches are kept as xml until converted with '--cache convert'
+    binaryDb = false;
     printf("Reading and parsing resource cache, please wait... ");
     fflush(stdout);
     QXmlStreamReader xml(&cacheFile);
@@ -158,17 +315,265 @@ bool Cache::read()
 	}
       }
 
-      resources.append(resource);
+      insertResource(resource);
     }
     cacheFile.close();
-    resAtLoad = resources.length();
+    resAtLoad = getResourceCount();
     printf("\033[1;32mDone!\033[0m\n");
-    printf("Successfully parsed %d resources!\n\n", resources.length());
+    printf("Successfully parsed %d resources!\n\n", resAtLoad);
     return true;
   }
   return false;
 }
 
+bool Cache::readBinary()
+{
+  binFile.setFileName(cacheDir.absolutePath() + "/db.bin");
+  if(!binFile.open(QIODevice::ReadOnly)) {
+    printf("Couldn't open 'db.bin', please check file permissions...\n");
+    return false;
+  }
+  printf("Mapping binary resource cache, please wait... ");
+  fflush(stdout);
+  qint64 fileSize = binFile.size();
+  if(fileSize < BINHEADERSIZE ||
+     (binData = binFile.map(0, fileSize)) == nullptr) {
+    printf("\033[1;31mFailed!\033[0m\n");
+    closeBinary();
+    return false;
+  }
+  if(memcmp(binData, BINMAGIC, 8) != 0 ||
+     qFromLittleEndian<quint32>(binData + 8) != BINVERSION) {
+    printf("\033[1;31mFailed!\033[0m\n'db.bin' is not a supported binary cache version. Please convert it with a matching Skyscraper version using '--cache convert:xml'.\n");
+    closeBinary();
+    return false;
+  }
+  binStringCount = qFromLittleEndian<quint32>(binData + 12);
+  binRecordCount = qFromLittleEndian<quint32>(binData + 16);
+  binBlobSize = qFromLittleEndian<quint64>(binData + 24);
+  if(fileSize != BINHEADERSIZE +
+     (qint64)binStringCount * BINSTRINGSIZE +
+     (qint64)binRecordCount * BINRECORDSIZE +
+     binBlobSize) {
+    printf("\033[1;31mFailed!\033[0m\n'db.bin' is truncated or corrupt.\n");
+    closeBinary();
+    return false;
+  }
+
+  // Only cache ids, types and sources are decoded here. Values are decoded per rom on demand
+  const uchar *records = binData + BINHEADERSIZE + (qint64)binStringCount * BINSTRINGSIZE;
+  QHash<quint32, QString> typeSourceStrings;
+  quint32 runStart = 0;
+  for(quint32 a = 0; a < binRecordCount; ++a) {
+    const uchar *record = records + (qint64)a * BINRECORDSIZE;
+    for(int b = 0; b < 4; ++b) {
+      if(qFromLittleEndian<quint32>(record + b * 4) >= binStringCount) {
+	printf("\033[1;31mFailed!\033[0m\n'db.bin' has an invalid record.\n");
+	binIndex.clear();
+	resCountsMap.clear();
+	closeBinary();
+	return false;
+      }
+    }
+    quint32 typeIdx = qFromLittleEndian<quint32>(record + 4);
+    quint32 sourceIdx = qFromLittleEndian<quint32>(record + 8);
+    if(!typeSourceStrings.contains(typeIdx)) {
+      typeSourceStrings.insert(typeIdx, intern(binString(typeIdx)));
+    }
+    if(!typeSourceStrings.contains(sourceIdx)) {
+      typeSourceStrings.insert(sourceIdx, intern(binString(sourceIdx)));
+    }
+    addToResCounts(typeSourceStrings.value(sourceIdx), typeSourceStrings.value(typeIdx));
+    if(a + 1 == binRecordCount ||
+       qFromLittleEndian<quint32>(record) !=
+       qFromLittleEndian<quint32>(record + BINRECORDSIZE)) {
+      binIndex.insert(binString(qFromLittleEndian<quint32>(record)),
+		      qMakePair(runStart, a + 1 - runStart));
+      runStart = a + 1;
+    }
+  }
+  binaryDb = true;
+  resAtLoad = binRecordCount;
+  printf("\033[1;32mDone!\033[0m\n");
+  printf("Successfully mapped %d resources!\n\n", resAtLoad);
+  return true;
+}
+
+void Cache::closeBinary()
+{
+  if(binData != nullptr) {
+    binFile.unmap(binData);
+    binData = nullptr;
+  }
+  if(binFile.isOpen()) {
+    binFile.close();
+  }
+}
+
+QString Cache::binString(const quint32 &index)
+{
+  const uchar *entry = binData + BINHEADERSIZE + (qint64)index * BINSTRINGSIZE;
+  quint32 offset = qFromLittleEndian<quint32>(entry);
+  quint32 length = qFromLittleEndian<quint32>(entry + 4);
+  if((qint64)offset + length > binBlobSize) {
+    return QString();
+  }
+  const char *blob = (const char *)binData + BINHEADERSIZE +
+    (qint64)binStringCount * BINSTRINGSIZE + (qint64)binRecordCount * BINRECORDSIZE;
+  return QString::fromUtf8(blob + offset, length);
+}
+
+void Cache::materialize(const QString &cacheId)
+{
+  if(binIndex.isEmpty()) {
+    return;
+  }
+  QHash<QString, QPair<quint32, quint32> >::iterator it = binIndex.find(cacheId);
+  if(it == binIndex.end()) {
+    return;
+  }
+  QPair<quint32, quint32> range = it.value();
+  binIndex.erase(it);
+  const uchar *records = binData + BINHEADERSIZE + (qint64)binStringCount * BINSTRINGSIZE;
+  for(quint32 a = range.first; a < range.first + range.second; ++a) {
+    const uchar *record = records + (qint64)a * BINRECORDSIZE;
+    Resource resource;
+    resource.cacheId = cacheId;
+    resource.type = binString(qFromLittleEndian<quint32>(record + 4));
+    resource.source = binString(qFromLittleEndian<quint32>(record + 8));
+    resource.value = binString(qFromLittleEndian<quint32>(record + 12));
+    resource.timestamp = qFromLittleEndian<qint64>(record + 16);
+    if(resource.type == "cover" || resource.type == "screenshot" ||
+       resource.type == "wheel" || resource.type == "marquee" ||
+       resource.type == "video") {
+      if(!QFileInfo::exists(cacheDir.absolutePath() + "/" + resource.value)) {
+	printf("Source file '%s' missing, skipping entry...\n",
+	       resource.value.toStdString().c_str());
+	continue;
+      }
+    }
+    insertResource(resource);
+  }
+}
+
+void Cache::materializeAll()
+{
+  for(const auto &cacheId: binIndex.keys()) {
+    materialize(cacheId);
+  }
+  closeBinary();
+}
+
+bool Cache::replayJournal()
+{
+  QFile replayFile(cacheDir.absolutePath() + "/db.journal");
+  if(!replayFile.open(QIODevice::ReadWrite)) {
+    return false;
+  }
+  printf("Replaying resource journal, please wait... ");
+  fflush(stdout);
+  QDataStream in(&replayFile);
+  in.setVersion(QDataStream::Qt_5_0);
+  quint32 magic = 0;
+  quint32 version = 0;
+  in >> magic >> version;
+  if(in.status() != QDataStream::Ok ||
+     magic != JOURNALMAGIC || version != JOURNALVERSION) {
+    printf("\033[1;33mUnknown journal format, ignoring it!\033[0m\n\n");
+    replayFile.close();
+    // Start a fresh journal on the next write instead of appending to this one
+    QFile::remove(replayFile.fileName());
+    return false;
+  }
+  qint64 lastGoodPos = replayFile.pos();
+  while(!in.atEnd()) {
+    Resource resource;
+    in >> resource.cacheId >> resource.type >> resource.source
+       >> resource.value >> resource.timestamp;
+    if(in.status() != QDataStream::Ok) {
+      // Incomplete record from an interrupted run, cut it off so we can append again
+      printf("\033[1;33mDropping incomplete record at end of journal!\033[0m ");
+      replayFile.resize(lastGoodPos);
+      break;
+    }
+    lastGoodPos = replayFile.pos();
+    if(resource.type == "cover" || resource.type == "screenshot" ||
+       resource.type == "wheel" || resource.type == "marquee" ||
+       resource.type == "video") {
+      if(!QFileInfo::exists(cacheDir.absolutePath() + "/" + resource.value)) {
+	continue;
+      }
+    }
+    materialize(resource.cacheId);
+    if(!resources.value(resource.cacheId).contains(qMakePair(resource.type, resource.source))) {
+      addToResCounts(resource.source, resource.type);
+    }
+    insertResource(resource);
+    journalCount++;
+  }
+  replayFile.close();
+  printf("\033[1;32mDone!\033[0m\n");
+  printf("Successfully replayed %d resources from previous run(s)!\n\n", journalCount);
+  return journalCount > 0;
+}
+
+void Cache::appendJournal(const Resource &resource)
+{
+  if(!journalFile.isOpen()) {
+    journalFile.setFileName(cacheDir.absolutePath() + "/db.journal");
+    if(!journalFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+      // Not fatal, the resource will still be written when the database is compacted
+      unjournaled = true;
+      return;
+    }
+    if(journalFile.size() == 0) {
+      QDataStream header(&journalFile);
+      header.setVersion(QDataStream::Qt_5_0);
+      header << JOURNALMAGIC << JOURNALVERSION;
+    }
+  }
+  QByteArray record;
+  QDataStream out(&record, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << resource.cacheId << resource.type << resource.source
+      << resource.value << resource.timestamp;
+  if(journalFile.write(record) != record.size() || !journalFile.flush()) {
+    unjournaled = true;
+    return;
+  }
+  journalCount++;
+  if(++journalUnsynced >= JOURNALSYNCINTERVAL) {
+    syncJournal();
+  }
+}
+
+bool Cache::syncJournal()
+{
+  journalUnsynced = 0;
+  if(!journalFile.isOpen()) {
+    return true;
+  }
+  if(!journalFile.flush()) {
+    return false;
+  }
+#if defined(Q_OS_WIN)
+  return _commit(journalFile.handle()) == 0;
+#else
+  return fsync(journalFile.handle()) == 0;
+#endif
+}
+
+void Cache::removeJournal()
+{
+  if(journalFile.isOpen()) {
+    journalFile.close();
+  }
+  QFile::remove(cacheDir.absolutePath() + "/db.journal");
+  journalCount = 0;
+  journalUnsynced = 0;
+  unjournaled = false;
+}
+
 void Cache::printPriorities(QString cacheId)
 {
   GameEntry game;
@@ -242,6 +647,9 @@ void Cache::editResources(QSharedPointer<Queue> queue,
 			  const QString &command,
 			  const QString &type)
 {
+  materializeAll();
+  unjournaled = true;
+
   // Check sanity of command and parameters, if any
   if(!command.isEmpty()) {
     if(command == "new") {
@@ -266,13 +674,9 @@ void Cache::editResources(QSharedPointer<Queue> queue,
 
   int queueLength = queue->length();
   printf("\033[1;33mEntering resource cache editing mode! This mode allows you to edit textual resources for your files. To add media resources use the 'import' scraping module instead.\nNote that you can provide one or more file names on command line to edit resources for just those specific files. You can also use the '--startat' and '--endat' command line options to narrow down the span of the roms you wish to edit. Otherwise Skyscraper will edit ALL files found in the input folder one by one.\033[0m\n\n");
-  while(queue->hasEntry()) {
-    QFileInfo info = queue->takeEntry();
-    QString cacheId = getQuickId(info);
-    if(cacheId.isEmpty()) {
-      cacheId = NameTools::getCacheId(info);
-      addQuickId(info, cacheId);
-    }
+  while(!queue->isEmpty() && !queue->isCancelled()) {
+    QFileInfo info = queue->takeFirst();
+    QString cacheId = getCacheId(info);
     bool doneEdit = false;
     printPriorities(cacheId);
     while(!doneEdit) {
@@ -308,14 +712,12 @@ void Cache::editResources(QSharedPointer<Queue> queue,
       } else if(userInput == "S") {
 	printf("\033[1;34mResources connected to this rom:\033[0m\n");
 	bool found = false;
-	for(const auto &res: resources) {
-	  if(res.cacheId == cacheId) {
-	    printf("\033[1;33m%s\033[0m (%s): '\033[1;32m%s\033[0m'\n",
-		   res.type.toStdString().c_str(),
-		   res.source.toStdString().c_str(),
-		   res.value.toStdString().c_str());
-	    found = true;
-	  }
+	for(const auto &res: resources.value(cacheId)) {
+	  printf("\033[1;33m%s\033[0m (%s): '\033[1;32m%s\033[0m'\n",
+		 res.type.toStdString().c_str(),
+		 res.source.toStdString().c_str(),
+		 res.value.toStdString().c_str());
+	  found = true;
 	}
 	if(!found)
 	  printf("None\n");
@@ -439,18 +841,8 @@ void Cache::editResources(QSharedPointer<Queue> queue,
 	    continue;
 	  } else if(!value.isEmpty() && QRegularExpression(expression).match(value).hasMatch()) {
 	    newRes.value = value;
-	    bool updated = false;
-	    QMutableListIterator<Resource> it(resources);
-	    while(it.hasNext()) {
-	      Resource res = it.next();
-	      if(res.cacheId == newRes.cacheId &&
-		 res.type == newRes.type &&
-		 res.source == newRes.source) {
-		it.remove();
-		updated = true;
-	      }
-	    }
-	    resources.append(newRes);
+	    bool updated = resources.value(cacheId).contains(qMakePair(newRes.type, newRes.source));
+	    insertResource(newRes);
 	    if(updated) {
 	      printf(">>> Updated existing ");
 	    } else {
@@ -465,19 +857,18 @@ void Cache::editResources(QSharedPointer<Queue> queue,
 	}
       } else if(userInput == "d") {
 	int b = 1;
-	QList<int> resIds;
+	QList<QPair<QString, QString> > resIds;
 	printf("\033[1;34mWhich resource id would you like to remove?\033[0m (Enter to cancel)\n");
-	for(int a = 0; a < resources.length(); ++a) {
-	  if(resources.at(a).cacheId == cacheId &&
-	     resources.at(a).type != "screenshot" &&
-	     resources.at(a).type != "cover" &&
-	     resources.at(a).type != "wheel" &&
-	     resources.at(a).type != "marquee" &&
-	     resources.at(a).type != "video") {
-	    printf("\033[1;33m%d\033[0m) \033[1;33m%s\033[0m (%s): '\033[1;32m%s\033[0m'\n", b, resources.at(a).type.toStdString().c_str(),
-		   resources.at(a).source.toStdString().c_str(),
-		   resources.at(a).value.toStdString().c_str());
-	    resIds.append(a);
+	for(const auto &res: resources.value(cacheId)) {
+	  if(res.type != "screenshot" &&
+	     res.type != "cover" &&
+	     res.type != "wheel" &&
+	     res.type != "marquee" &&
+	     res.type != "video") {
+	    printf("\033[1;33m%d\033[0m) \033[1;33m%s\033[0m (%s): '\033[1;32m%s\033[0m'\n", b, res.type.toStdString().c_str(),
+		   res.source.toStdString().c_str(),
+		   res.value.toStdString().c_str());
+	    resIds.append(qMakePair(res.type, res.source));
 	    b++;
 	  }
 	}
@@ -495,24 +886,24 @@ void Cache::editResources(QSharedPointer<Queue> queue,
 	} else {
 	  int chosen = atoi(typeInput.c_str());
 	  if(chosen >= 1 && chosen <= resIds.length()) {
-	    resources.removeAt(resIds.at(chosen - 1)); // -1 because lists start at 0
+	    resources[cacheId].remove(resIds.at(chosen - 1)); // -1 because lists start at 0
+	    if(resources.value(cacheId).isEmpty()) {
+	      resources.remove(cacheId);
+	      removeQuickIds(QSet<QString>() << cacheId);
+	    }
 	    printf("<<< Removed resource id %d\n\n", chosen);
 	  } else {
 	    printf("Incorrect resource id, cancelling...\n\n");
 	  }
 	}
       } else if(userInput == "D") {
-	QMutableListIterator<Resource> it(resources);
 	bool found = false;
-	while(it.hasNext()) {
-	  Resource res = it.next();
-	  if(res.cacheId == cacheId) {
-	    printf("<<< Removed \033[1;33m%s\033[0m (%s) with value '\033[1;32m%s\033[0m'\n", res.type.toStdString().c_str(),
-		   res.source.toStdString().c_str(),
-		   res.value.toStdString().c_str());
-	    it.remove();
-	    found = true;
-	  }
+	removeQuickIds(QSet<QString>() << cacheId);
+	for(const auto &res: resources.take(cacheId)) {
+	  printf("<<< Removed \033[1;33m%s\033[0m (%s) with value '\033[1;32m%s\033[0m'\n", res.type.toStdString().c_str(),
+		 res.source.toStdString().c_str(),
+		 res.value.toStdString().c_str());
+	  found = true;
 	}
 	if(!found)
 	  printf("No resources found for this rom...\n");
@@ -520,10 +911,8 @@ void Cache::editResources(QSharedPointer<Queue> queue,
       } else if(userInput == "m") {
 	printf("\033[1;34mResources from which module would you like to remove?\033[0m (Enter to cancel)\n");
 	QMap<QString, int> modules;
-	for(const auto &res: resources) {
-	  if(res.cacheId == cacheId) {
-	    modules[res.source] += 1;
-	  }
+	for(const auto &res: resources.value(cacheId)) {
+	  modules[res.source] += 1;
 	}
 	QMap<QString, int>::iterator it;
 	for(it = modules.begin(); it != modules.end(); ++it) {
@@ -541,15 +930,18 @@ void Cache::editResources(QSharedPointer<Queue> queue,
 	  printf("Resource removal cancelled...\n\n");
 	  continue;
 	} else if(modules.contains(QString(typeInput.c_str()))) {
-	  QMutableListIterator<Resource> it(resources);
+	  QMutableHashIterator<QPair<QString, QString>, Resource> it(resources[cacheId]);
 	  int removed = 0;
 	  while(it.hasNext()) {
-	    Resource res = it.next();
-	    if(res.cacheId == cacheId && res.source == QString(typeInput.c_str())) {
+	    if(it.next().value().source == QString(typeInput.c_str())) {
 	      it.remove();
 	      removed++;
 	    }
 	  }
+	  if(resources.value(cacheId).isEmpty()) {
+	    resources.remove(cacheId);
+	    removeQuickIds(QSet<QString>() << cacheId);
+	  }
 	  printf("<<< Removed %d resource(s) connected to rom from module '\033[1;32m%s\033[0m'\n\n", removed,
 		 typeInput.c_str());
 	} else {
@@ -558,10 +950,8 @@ void Cache::editResources(QSharedPointer<Queue> queue,
       } else if(userInput == "t") {
 	printf("\033[1;34mResources of which type would you like to remove?\033[0m (Enter to cancel)\n");
 	QMap<QString, int> types;
-	for(const auto &res: resources) {
-	  if(res.cacheId == cacheId) {
-	    types[res.type] += 1;
-	  }
+	for(const auto &res: resources.value(cacheId)) {
+	  types[res.type] += 1;
 	}
 	QMap<QString, int>::iterator it;
 	for(it = types.begin(); it != types.end(); ++it) {
@@ -579,15 +969,18 @@ void Cache::editResources(QSharedPointer<Queue> queue,
 	  printf("Resource removal cancelled...\n\n");
 	  continue;
 	} else if(types.contains(QString(typeInput.c_str()))) {
-	  QMutableListIterator<Resource> it(resources);
+	  QMutableHashIterator<QPair<QString, QString>, Resource> it(resources[cacheId]);
 	  int removed = 0;
 	  while(it.hasNext()) {
-	    Resource res = it.next();
-	    if(res.cacheId == cacheId && res.type == QString(typeInput.c_str())) {
+	    if(it.next().value().type == QString(typeInput.c_str())) {
 	      it.remove();
 	      removed++;
 	    }
 	  }
+	  if(resources.value(cacheId).isEmpty()) {
+	    resources.remove(cacheId);
+	    removeQuickIds(QSet<QString>() << cacheId);
+	  }
 	  printf("<<< Removed %d resource(s) connected to rom of type '\033[1;32m%s\033[0m'\n\n", removed, typeInput.c_str());
 	} else {
 	  printf("No resources of type '\033[1;32m%s\033[0m' found, cancelling...\n\n", typeInput.c_str());
@@ -596,7 +989,7 @@ void Cache::editResources(QSharedPointer<Queue> queue,
 	printf("Exiting without saving changes.\n");
 	exit(0);
       } else if(userInput == "q") {
-	queue->clear();
+	queue->cancel();
 	doneEdit = true;
 	continue;
       }
@@ -608,6 +1001,8 @@ bool Cache::purgeResources(QString purgeStr)
 {
   purgeStr.replace("purge:", "");
   printf("Purging requested resources from cache, please wait...\n");
+  materializeAll();
+  unjournaled = true;
 
   QString module = "";
   QString type = "";
@@ -626,26 +1021,35 @@ bool Cache::purgeResources(QString purgeStr)
 
   int purged = 0;
 
-  QMutableListIterator<Resource> it(resources);
-  while(it.hasNext()) {
-    Resource res = it.next();
-    bool remove = false;
-    if(res.source == module || res.type == type) {
-      remove = true;
-    }
-    if(remove) {
-      if(res.type == "cover" || res.type == "screenshot" ||
-	 res.type == "wheel" || res.type == "marquee" ||
-	 res.type == "video") {
-	if(!QFile::remove(cacheDir.absolutePath() + "/" + res.value)) {
-	  printf("Couldn't purge media file '%s', skipping...\n", res.value.toStdString().c_str());
-	  continue;
+  QSet<QString> removedIds;
+  QMutableHashIterator<QString, ResourceMap> idIt(resources);
+  while(idIt.hasNext()) {
+    QMutableHashIterator<QPair<QString, QString>, Resource> it(idIt.next().value());
+    while(it.hasNext()) {
+      Resource res = it.next().value();
+      bool remove = false;
+      if(res.source == module || res.type == type) {
+	remove = true;
+      }
+      if(remove) {
+	if(res.type == "cover" || res.type == "screenshot" ||
+	   res.type == "wheel" || res.type == "marquee" ||
+	   res.type == "video") {
+	  if(!QFile::remove(cacheDir.absolutePath() + "/" + res.value)) {
+	    printf("Couldn't purge media file '%s', skipping...\n", res.value.toStdString().c_str());
+	    continue;
+	  }
 	}
+	it.remove();
+	purged++;
       }
-      it.remove();
-      purged++;
+    }
+    if(idIt.value().isEmpty()) {
+      removedIds.insert(idIt.key());
+      idIt.remove();
     }
   }
+  removeQuickIds(removedIds);
   printf("Successfully purged %d resources from the cache.\n", purged);
   return true;
 }
@@ -664,31 +1068,42 @@ bool Cache::purgeAll(const bool unattend)
   }
 
   printf("Purging ALL resources for the selected platform, please wait...");
+  materializeAll();
+  unjournaled = true;
 
   int purged = 0;
   int dots = 0;
   // Always make dotMod at least 1 or it will give "floating point exception" when modulo
-  int dotMod = resources.size() * 0.1 + 1;
+  int dotMod = getResourceCount() * 0.1 + 1;
 
-  QMutableListIterator<Resource> it(resources);
-  while(it.hasNext()) {
-    if(dots % dotMod == 0) {
-      printf(".");
-      fflush(stdout);
-    }
-    dots++;
-    Resource res = it.next();
-    if(res.type == "cover" || res.type == "screenshot" ||
-       res.type == "wheel" || res.type == "marquee" ||
-       res.type == "video") {
-      if(!QFile::remove(cacheDir.absolutePath() + "/" + res.value)) {
-	printf("Couldn't purge media file '%s', skipping...\n", res.value.toStdString().c_str());
-	continue;
+  QSet<QString> removedIds;
+  QMutableHashIterator<QString, ResourceMap> idIt(resources);
+  while(idIt.hasNext()) {
+    QMutableHashIterator<QPair<QString, QString>, Resource> it(idIt.next().value());
+    while(it.hasNext()) {
+      if(dots % dotMod == 0) {
+	printf(".");
+	fflush(stdout);
       }
+      dots++;
+      Resource res = it.next().value();
+      if(res.type == "cover" || res.type == "screenshot" ||
+	 res.type == "wheel" || res.type == "marquee" ||
+	 res.type == "video") {
+	if(!QFile::remove(cacheDir.absolutePath() + "/" + res.value)) {
+	  printf("Couldn't purge media file '%s', skipping...\n", res.value.toStdString().c_str());
+	  continue;
+	}
+      }
+      it.remove();
+      purged++;
+    }
+    if(idIt.value().isEmpty()) {
+      removedIds.insert(idIt.key());
+      idIt.remove();
     }
-    it.remove();
-    purged++;
   }
+  removeQuickIds(removedIds);
   printf("\033[1;32m Done!\033[0m\n");
   if(purged == 0) {
     printf("No resources for the current platform found in the resource cache.\n");
@@ -724,28 +1139,18 @@ QList<QFileInfo> Cache::getFileInfos(const QString &inputFolder, const QString &
 
 QList<QString> Cache::getCacheIdList(const QList<QFileInfo> &fileInfos)
 {
+  prepareCacheIds(fileInfos);
   QList<QString> cacheIdList;
-  int dots = 0;
-  // Always make dotMod at least 1 or it will give "floating point exception" when modulo
-  int dotMod = fileInfos.size() * 0.1 + 1;
   for(const auto &info: fileInfos) {
-    if(dots % dotMod == 0) {
-      printf(".");
-      fflush(stdout);
-    }
-    dots++;
-    QString cacheId = getQuickId(info);
-    if(cacheId.isEmpty()) {
-      cacheId = NameTools::getCacheId(info);
-      addQuickId(info, cacheId);
-    }
-    cacheIdList.append(cacheId);
+    cacheIdList.append(getCacheId(info));
   }
   return cacheIdList;
 }
 
 void Cache::assembleReport(const Settings &config, const QString filter)
 {
+  materializeAll();
+
   QString reportStr = config.cacheOptions;
 
   if(!reportStr.contains("report:missing=")) {
@@ -902,12 +1307,10 @@ void Cache::assembleReport(const Settings &config, const QString filter)
 	}
 	dots++;
 	bool found = false;
-	for(const auto &res: resources) {
-	  if(res.cacheId == cacheIdList.at(a)) {
-	    if(res.type == resType) {
-	      found = true;
-	      break;
-	    }
+	for(const auto &res: resources.value(cacheIdList.at(a))) {
+	  if(res.type == resType) {
+	    found = true;
+	    break;
 	  }
 	}
 	if(!found) {
@@ -942,42 +1345,50 @@ bool Cache::vacuumResources(const QString inputFolder, const QString filter,
   printf("Vacuuming cache, this can take several minutes, please wait...");
   QList<QFileInfo> fileInfos = getFileInfos(inputFolder, filter);
   // Clean the quick id's aswell
-  QMap<QString, QPair<qint64, QString> > quickIdsCleaned;
+  QHash<QuickIdKey, QString> quickIdsCleaned;
   for(const auto &info: fileInfos) {
-    QString filePath = info.absoluteFilePath();
-    if(quickIds.contains(filePath)) {
-      quickIdsCleaned[filePath] = quickIds[filePath];
+    QuickIdKey key = getQuickIdKey(info);
+    if(quickIds.contains(key)) {
+      quickIdsCleaned.insert(key, quickIds.value(key));
     }
   }
-  quickIds = quickIdsCleaned;
+  quickIds.clear();
+  quickIdFiles.clear();
+  for(QHash<QuickIdKey, QString>::const_iterator it = quickIdsCleaned.constBegin();
+      it != quickIdsCleaned.constEnd(); ++it) {
+    insertQuickId(it.key(), it.value());
+  }
   QList<QString> cacheIdList = getCacheIdList(fileInfos);
   if(cacheIdList.isEmpty()) {
     printf("No cache id's found, something is wrong, cancelling...\n");
     return false;
   }
 
+  materializeAll();
+  unjournaled = true;
+  QSet<QString> cacheIds = cacheIdList.toSet();
+
   int vacuumed = 0;
   {
     int dots = 0;
     // Always make dotMod at least 1 or it will give "floating point exception" when modulo
     int dotMod = resources.size() * 0.1 + 1;
 
-    QMutableListIterator<Resource> it(resources);
-    while(it.hasNext()) {
+    QSet<QString> removedIds;
+    QMutableHashIterator<QString, ResourceMap> idIt(resources);
+    while(idIt.hasNext()) {
       if(dots % dotMod == 0) {
 	printf(".");
 	fflush(stdout);
       }
       dots++;
-      Resource res = it.next();
-      bool remove = true;
-      for(const auto &cacheId: cacheIdList) {
-	if(res.cacheId == cacheId) {
-	  remove = false;
-	  break;
-	}
+      idIt.next();
+      if(cacheIds.contains(idIt.key())) {
+	continue;
       }
-      if(remove) {
+      QMutableHashIterator<QPair<QString, QString>, Resource> it(idIt.value());
+      while(it.hasNext()) {
+	Resource res = it.next().value();
 	if(res.type == "cover" || res.type == "screenshot" ||
 	   res.type == "wheel" || res.type == "marquee" ||
 	   res.type == "video") {
@@ -992,7 +1403,12 @@ bool Cache::vacuumResources(const QString inputFolder, const QString filter,
 	it.remove();
 	vacuumed++;
       }
+      if(idIt.value().isEmpty()) {
+	removedIds.insert(idIt.key());
+	idIt.remove();
+      }
     }
+    removeQuickIds(removedIds);
   }
   printf("\033[1;32m Done!\033[0m\n");
   if(vacuumed == 0) {
@@ -1168,47 +1584,59 @@ bool Cache::write(const bool onlyQuickId)
 {
   QMutexLocker locker(&cacheMutex);
 
-  QFile quickIdFile(cacheDir.absolutePath() + "/quickid.xml");
-  if(quickIdFile.open(QIODevice::WriteOnly)) {
-    printf("Writing quick id xml, please wait... ");
-    fflush(stdout);
-    QXmlStreamWriter xml(&quickIdFile);
-    xml.setAutoFormatting(true);
-    xml.writeStartDocument();
-    xml.writeStartElement("quickids");
-    for(const auto &key: quickIds.keys()) {
-      xml.writeStartElement("quickid");
-      xml.writeAttribute("filepath", key);
-      xml.writeAttribute("timestamp", QString::number(quickIds[key].first));
-      xml.writeAttribute("id", quickIds[key].second);
-      xml.writeEndElement();
-    }
-    xml.writeEndElement();
-    xml.writeEndDocument();
-    printf("\033[1;32mDone!\033[0m\n");
-    quickIdFile.close();
-    if(onlyQuickId) {
+  if(writeQuickIds() && onlyQuickId) {
+    return true;
+  }
+
+  // As long as the journal holds all changes and is still small, syncing it is enough
+  int resourceCount = getResourceCount();
+  if(!unjournaled &&
+     journalCount * 100 <= resourceCount * JOURNALCOMPACTPERCENT) {
+    if(syncJournal()) {
+      if(journalFile.isOpen()) {
+	journalFile.close();
+      }
+      if(journalCount > 0) {
+	printf("Resource journal synced, %d resources pending compaction.\n\n", journalCount);
+      }
       return true;
     }
+    printf("\033[1;33mCouldn't sync resource journal, writing full database instead!\033[0m\n");
   }
 
+  materializeAll();
+  bool result = false;
+  if(binaryDb) {
+    result = writeBinary();
+  } else {
+    result = writeXml();
+  }
+  if(result) {
+    removeJournal();
+  }
+  return result;
+}
+
+bool Cache::writeXml()
+{
   bool result = false;
   QFile cacheFile(cacheDir.absolutePath() + "/db.xml");
   if(cacheFile.open(QIODevice::WriteOnly)) {
+    int resourceCount = getResourceCount();
     printf("Writing %d (%d new) resources to cache, please wait... ",
-	   resources.length(), resources.length() - resAtLoad);
+	   resourceCount, resourceCount - resAtLoad);
     fflush(stdout);
     QXmlStreamWriter xml(&cacheFile);
     xml.setAutoFormatting(true);
     xml.writeStartDocument();
     xml.writeStartElement("resources");
-    for(const auto &resource: resources) {
+    for(const auto resource: getSortedResources()) {
       xml.writeStartElement("resource");
-      xml.writeAttribute("id", resource.cacheId);
-      xml.writeAttribute("type", resource.type);
-      xml.writeAttribute("source", resource.source);
-      xml.writeAttribute("timestamp", QString::number(resource.timestamp));
-      xml.writeCharacters(resource.value);
+      xml.writeAttribute("id", resource->cacheId);
+      xml.writeAttribute("type", resource->type);
+      xml.writeAttribute("source", resource->source);
+      xml.writeAttribute("timestamp", QString::number(resource->timestamp));
+      xml.writeCharacters(resource->value);
       xml.writeEndElement();
     }
     xml.writeEndElement();
@@ -1220,6 +1648,71 @@ bool Cache::write(const bool onlyQuickId)
   return result;
 }
 
+bool Cache::writeBinary()
+{
+  int resourceCount = getResourceCount();
+  printf("Writing %d (%d new) resources to binary cache, please wait... ",
+	 resourceCount, resourceCount - resAtLoad);
+  fflush(stdout);
+
+  QHash<QString, quint32> stringIds;
+  QList<QString> strings;
+  auto stringId = [&stringIds, &strings](const QString &str) -> quint32 {
+    QHash<QString, quint32>::const_iterator it = stringIds.constFind(str);
+    if(it != stringIds.constEnd()) {
+      return it.value();
+    }
+    quint32 id = strings.length();
+    stringIds.insert(str, id);
+    strings.append(str);
+    return id;
+  };
+
+  QByteArray records;
+  records.reserve(resourceCount * BINRECORDSIZE);
+  {
+    QDataStream recordStream(&records, QIODevice::WriteOnly);
+    recordStream.setByteOrder(QDataStream::LittleEndian);
+    for(const auto resource: getSortedResources()) {
+      recordStream << stringId(resource->cacheId) << stringId(resource->type)
+		   << stringId(resource->source) << stringId(resource->value)
+		   << (qint64)resource->timestamp;
+    }
+  }
+
+  QByteArray stringTable;
+  QByteArray blob;
+  {
+    QDataStream stringStream(&stringTable, QIODevice::WriteOnly);
+    stringStream.setByteOrder(QDataStream::LittleEndian);
+    for(const auto &str: strings) {
+      QByteArray utf8 = str.toUtf8();
+      stringStream << (quint32)blob.size() << (quint32)utf8.size();
+      blob.append(utf8);
+    }
+  }
+
+  QSaveFile cacheFile(cacheDir.absolutePath() + "/db.bin");
+  if(!cacheFile.open(QIODevice::WriteOnly)) {
+    printf("\033[1;31mFailed!\033[0m\n");
+    return false;
+  }
+  QDataStream out(&cacheFile);
+  out.setByteOrder(QDataStream::LittleEndian);
+  out.writeRawData(BINMAGIC, 8);
+  out << BINVERSION << (quint32)strings.length() << (quint32)resourceCount
+      << (quint32)0 << (quint64)blob.size();
+  out.writeRawData(stringTable.constData(), stringTable.size());
+  out.writeRawData(records.constData(), records.size());
+  out.writeRawData(blob.constData(), blob.size());
+  if(out.status() != QDataStream::Ok || !cacheFile.commit()) {
+    printf("\033[1;31mFailed!\033[0m\n");
+    return false;
+  }
+  printf("\033[1;32mDone!\033[0m\n\n");
+  return true;
+}
+
 // This verifies all attached media files and deletes those that have no entry in the cache
 void Cache::validate()
 {
@@ -1227,10 +1720,12 @@ void Cache::validate()
 
   printf("Starting resource cache validation run, please wait...\n");
 
-  if(!QFileInfo::exists(cacheDir.absolutePath() + "/db.xml")) {
-    printf("'db.xml' not found, cache cleaning cancelled...\n");
+  if(!QFileInfo::exists(cacheDir.absolutePath() + "/db.xml") &&
+     !QFileInfo::exists(cacheDir.absolutePath() + "/db.bin")) {
+    printf("'db.xml' or 'db.bin' not found, cache cleaning cancelled...\n");
     return;
   }
+  materializeAll();
 
   QDir coversDir(cacheDir.absolutePath() + "/covers", "*.*", QDir::Name, QDir::Files);
   QDir screenshotsDir(cacheDir.absolutePath() + "/screenshots", "*.*", QDir::Name, QDir::Files);
@@ -1280,11 +1775,13 @@ void Cache::validate()
 
 void Cache::verifyFiles(QDirIterator &dirIt, int &filesDeleted, int &filesNoDelete, QString resType)
 {
-  QList<QString> resFileNames;
-  for(const auto &resource: resources) {
-    if(resource.type == resType) {
-      QFileInfo resInfo(cacheDir.absolutePath() + "/" + resource.value);
-      resFileNames.append(resInfo.absoluteFilePath());
+  QSet<QString> resFileNames;
+  for(const auto &cacheIdResources: resources) {
+    for(const auto &resource: cacheIdResources) {
+      if(resource.type == resType) {
+	QFileInfo resInfo(cacheDir.absolutePath() + "/" + resource.value);
+	resFileNames.insert(resInfo.absoluteFilePath());
+      }
     }
   }
 
@@ -1307,23 +1804,22 @@ void Cache::verifyFiles(QDirIterator &dirIt, int &filesDeleted, int &filesNoDele
 void Cache::merge(Cache &mergeCache, bool overwrite, const QString &mergeCacheFolder)
 {
   printf("Merging databases, please wait...\n");
-  QList<Resource> mergeResources = mergeCache.getResources();
+  materializeAll();
+  mergeCache.materializeAll();
+  unjournaled = true;
 
   QDir mergeCacheDir(mergeCacheFolder);
 
   int resUpdated = 0;
   int resMerged = 0;
 
-  for(const auto &mergeResource: mergeResources) {
-    bool resExists = false;
-    // This type of iterator ensures we can delete items while iterating
-    QMutableListIterator<Resource> it(resources);
-    while(it.hasNext()) {
-      Resource res = it.next();
-      if(res.cacheId == mergeResource.cacheId &&
-	 res.type == mergeResource.type &&
-	 res.source == mergeResource.source) {
+  for(const auto &mergeResources: mergeCache.resources) {
+    for(const auto &mergeResource: mergeResources) {
+      bool resExists = false;
+      QPair<QString, QString> key = qMakePair(mergeResource.type, mergeResource.source);
+      if(resources.value(mergeResource.cacheId).contains(key)) {
 	if(overwrite) {
+	  Resource res = resources.value(mergeResource.cacheId).value(key);
 	  if(res.type == "cover" || res.type == "screenshot" ||
 	     res.type == "wheel" || res.type == "marquee" ||
 	     res.type == "video") {
@@ -1331,16 +1827,15 @@ void Cache::merge(Cache &mergeCache, bool overwrite, const QString &mergeCacheFo
 	      printf("Couldn't remove media file '%s' for updating, skipping...\n", res.value.toStdString().c_str());
 	      continue;
 	    }
-	    
 	  }
-	  it.remove();
+	  resources[mergeResource.cacheId].remove(key);
 	} else {
 	  resExists = true;
-	  break;
 	}
       }
-    }
-    if(!resExists) {
+      if(resExists) {
+	continue;
+      }
       if(mergeResource.type == "cover" || mergeResource.type == "screenshot" ||
 	 mergeResource.type == "wheel" || mergeResource.type == "marquee" ||
 	 mergeResource.type == "video") {
@@ -1356,18 +1851,43 @@ void Cache::merge(Cache &mergeCache, bool overwrite, const QString &mergeCacheFo
       } else {
 	resMerged++;
       }
-      resources.append(mergeResource);
+      insertResource(mergeResource);
     }
   }
   printf("Successfully updated %d resource(s) in cache!\n", resUpdated);
   printf("Successfully merged %d new resource(s) into cache!\n\n", resMerged);
 }
 
-QList<Resource> Cache::getResources()
+bool Cache::convert(const QString &format)
 {
-  return resources;
+  QString fromFile = "db.xml";
+  QString toFile = "db.bin";
+  if(format == "bin") {
+    binaryDb = true;
+  } else if(format == "xml") {
+    binaryDb = false;
+    fromFile = "db.bin";
+    toFile = "db.xml";
+  } else {
+    printf("Unknown cache format '%s', please use 'bin' or 'xml'...\n", format.toStdString().c_str());
+    return false;
+  }
+  printf("Converting resource cache to '%s', please wait...\n", toFile.toStdString().c_str());
+  unjournaled = true;
+  if(!write()) {
+    printf("Couldn't write '%s', leaving '%s' untouched...\n",
+	   toFile.toStdString().c_str(), fromFile.toStdString().c_str());
+    return false;
+  }
+  if(QFileInfo::exists(cacheDir.absolutePath() + "/" + fromFile) &&
+     !QFile::remove(cacheDir.absolutePath() + "/" + fromFile)) {
+    printf("Couldn't remove old '%s', please remove it manually...\n", fromFile.toStdString().c_str());
+    return false;
+  }
+  printf("Successfully converted resource cache to '%s'!\n\n", toFile.toStdString().c_str());
+  return true;
 }
-    
+
 void Cache::addResources(GameEntry &entry, const Settings &config, QString &output)
 {
   QString cacheAbsolutePath = cacheDir.absolutePath();
@@ -1433,7 +1953,7 @@ void Cache::addResources(GameEntry &entry, const Settings &config, QString &outp
       resource.value = entry.releaseDate;
       addResource(resource, entry, cacheAbsolutePath, config, output);
     }
-    if(entry.videoData != "" && entry.videoFormat != "") {
+    if((entry.videoData != "" || !entry.getMediaFile(VIDEO).isEmpty()) && entry.videoFormat != "") {
       resource.type = "video";
       resource.value = "videos/" + entry.source + "/" + entry.cacheId + "." + entry.videoFormat;
       addResource(resource, entry, cacheAbsolutePath, config, output);
@@ -1468,20 +1988,17 @@ void Cache::addResource(Resource &resource,
 			QString &output)
 {
   QMutexLocker locker(&cacheMutex);
+  materialize(resource.cacheId);
   bool notFound = true;
-  // This type of iterator ensures we can delete items while iterating
-  QMutableListIterator<Resource> it(resources);
-  while(it.hasNext()) {
-    Resource res = it.next();
-    if(res.cacheId == resource.cacheId &&
-       res.type == resource.type &&
-       res.source == resource.source) {
+  QHash<QString, ResourceMap>::iterator idIt = resources.find(resource.cacheId);
+  if(idIt != resources.end()) {
+    QPair<QString, QString> key = qMakePair(resource.type, resource.source);
+    if(idIt.value().contains(key)) {
       if(config.refresh) {
-	it.remove();
+	idIt.value().remove(key);
       } else {
 	notFound = false;
       }
-      break;
     }
   }
 
@@ -1549,11 +2066,24 @@ void Cache::addResource(Resource &resource,
 	imageData->clear();
       }
     } else if(resource.type == "video") {
-      if(entry.videoData.size() <= config.videoSizeLimit) {
+      QString videoDownload = entry.getMediaFile(VIDEO);
+      qint64 videoSize = (videoDownload.isEmpty()?entry.videoData.size():QFileInfo(videoDownload).size());
+      if(videoSize <= config.videoSizeLimit) {
 	QFile f(cacheFile);
-	if(f.open(QIODevice::WriteOnly)) {
+	bool videoWritten = false;
+	if(!videoDownload.isEmpty()) {
+	  // Downloaded videos are already in the cache folder, so they are just moved into place
+	  f.remove();
+	  videoWritten = QFile::rename(videoDownload, cacheFile);
+	  if(videoWritten) {
+	    entry.setMediaFile(VIDEO, cacheFile);
+	  }
+	} else if(f.open(QIODevice::WriteOnly)) {
 	  f.write(entry.videoData);
 	  f.close();
+	  videoWritten = true;
+	}
+	if(videoWritten) {
 	  if(!config.videoConvertCommand.isEmpty()) {
 	    output.append("Video conversion: ");
 	    if(doVideoConvert(resource,
@@ -1588,12 +2118,21 @@ void Cache::addResource(Resource &resource,
 	  QFile::remove(cacheFile + ".png");
 	}
       }
-      resources.append(resource);
+      insertResource(resource);
+      appendJournal(resource);
     } else {
       printf("\033[1;33mWarning! Couldn't add resource to cache. Have you run out of disk space?\n\033[0m");
     }
     
   }
+
+  // Remove the downloaded video if it wasn't moved into the cache
+  if(resource.type == "video") {
+    QFileInfo videoDownload(entry.getMediaFile(VIDEO));
+    if(videoDownload.absolutePath() == cacheDir.absolutePath() + "/downloads") {
+      QFile::remove(videoDownload.absoluteFilePath());
+    }
+  }
 }
 
 bool Cache::doVideoConvert(Resource &resource,
@@ -1685,34 +2224,119 @@ bool Cache::hasAlpha(const QImage &image)
 }
 
 void Cache::addQuickId(const QFileInfo &info, const QString &cacheId) {
+  // Filename based cache ids are cheap to calculate and would be wrong after a rename
+  if(!NameTools::isCacheIdFromData(info)) {
+    return;
+  }
+  QuickIdKey key = getQuickIdKey(info);
   QMutexLocker locker(&quickIdMutex);
-  QPair<qint64, QString> pair; // Quick id pair
-  pair.first = info.lastModified().toMSecsSinceEpoch();
-  pair.second = cacheId;
-  quickIds[info.absoluteFilePath()] = pair;
+  insertQuickId(key, cacheId);
+}
+
+// A rom that has been modified gets a new key. The key of its previous version is dropped, since
+// it can never match again. Caller must hold quickIdMutex if other threads can access the index
+void Cache::insertQuickId(const QuickIdKey &key, const QString &cacheId)
+{
+  QPair<quint64, quint64> file = qMakePair(key.device, key.inode);
+  QHash<QPair<quint64, quint64>, QuickIdKey>::const_iterator fileIt = quickIdFiles.constFind(file);
+  if(fileIt != quickIdFiles.constEnd() && !(fileIt.value() == key)) {
+    quickIds.remove(fileIt.value());
+  }
+  quickIdFiles.insert(file, key);
+  quickIds.insert(key, cacheId);
 }
 
 QString Cache::getQuickId(const QFileInfo &info) {
+  if(!NameTools::isCacheIdFromData(info)) {
+    return NameTools::getCacheId(info);
+  }
+  QuickIdKey key = getQuickIdKey(info);
   QMutexLocker locker(&quickIdMutex);
-  if(quickIds.contains(info.absoluteFilePath()) &&
-     info.lastModified().toMSecsSinceEpoch() <= quickIds[info.absoluteFilePath()].first) {
-    return quickIds[info.absoluteFilePath()].second;
+  return quickIds.value(key);
+}
+
+// Drops the quick ids pointing at cache ids that no longer have any resources
+void Cache::removeQuickIds(const QSet<QString> &cacheIds)
+{
+  if(cacheIds.isEmpty()) {
+    return;
   }
-  return QString();
+  QMutexLocker locker(&quickIdMutex);
+  QMutableHashIterator<QuickIdKey, QString> it(quickIds);
+  while(it.hasNext()) {
+    if(cacheIds.contains(it.next().value())) {
+      quickIdFiles.remove(qMakePair(it.key().device, it.key().inode));
+      it.remove();
+    }
+  }
+}
+
+QString Cache::getCacheId(const QFileInfo &info)
+{
+  QString cacheId = getQuickId(info);
+  if(cacheId.isEmpty()) {
+    cacheId = NameTools::getCacheId(info);
+    addQuickId(info, cacheId);
+  }
+  return cacheId;
+}
+
+// Hashes all files that aren't in the quick id index yet, spread across all cores.
+// With 'allDigests' the checksums needed by the scraping module are calculated in the same pass
+void Cache::prepareCacheIds(const QList<QFileInfo> &fileInfos, const bool allDigests)
+{
+  QList<QFileInfo> missing;
+  for(const auto &info: fileInfos) {
+    if(getQuickId(info).isEmpty()) {
+      missing.append(info);
+    }
+  }
+  if(missing.isEmpty()) {
+    return;
+  }
+  printf("Calculating cache ids for %d files, please wait...", missing.length());
+  fflush(stdout);
+  QAtomicInt done(0);
+  // Always make dotMod at least 1 or it will give "floating point exception" when modulo
+  int dotMod = missing.length() * 0.1 + 1;
+  QtConcurrent::blockingMap(missing, [this, &done, dotMod, allDigests](const QFileInfo &info) {
+      addQuickId(info, NameTools::getCacheId(info, allDigests));
+      if(done.fetchAndAddRelaxed(1) % dotMod == 0) {
+	printf(".");
+	fflush(stdout);
+      }
+    });
+  printf(" \033[1;32mDone!\033[0m\n");
+}
+
+QuickIdKey Cache::getQuickIdKey(const QFileInfo &info)
+{
+  QuickIdKey key;
+  if(!FileTools::getFileId(info.absoluteFilePath(), key.device, key.inode)) {
+    // No inodes on this system, fall back to identifying the file by its path
+    QByteArray pathHash = QCryptographicHash::hash(info.absoluteFilePath().toUtf8(),
+						   QCryptographicHash::Md5);
+    key.inode = qFromLittleEndian<quint64>((const uchar *)pathHash.constData());
+  }
+  key.size = info.size();
+  key.modified = info.lastModified().toMSecsSinceEpoch();
+  return key;
 }
 
 bool Cache::hasEntries(const QString &cacheId, const QString scraper)
 {
   QMutexLocker locker(&cacheMutex);
-  for(const auto &res: resources) {
-    if(scraper.isEmpty()) {
-      if(res.cacheId == cacheId) {
-	return true;
-      }
-    } else {
-      if(res.cacheId == cacheId && res.source == scraper) {
-	return true;
-      }
+  materialize(cacheId);
+  QHash<QString, ResourceMap>::const_iterator idIt = resources.constFind(cacheId);
+  if(idIt == resources.constEnd()) {
+    return false;
+  }
+  if(scraper.isEmpty()) {
+    return !idIt.value().isEmpty();
+  }
+  for(const auto &res: idIt.value()) {
+    if(res.source == scraper) {
+      return true;
     }
   }
   return false;
@@ -1721,17 +2345,12 @@ bool Cache::hasEntries(const QString &cacheId, const QString scraper)
 void Cache::fillBlanks(GameEntry &entry, const QString scraper)
 {
   QMutexLocker locker(&cacheMutex);
+  materialize(entry.cacheId);
   QList<Resource> matchingResources;
   // Find all resources related to this particular rom
-  for(const auto &resource: resources) {
-    if(scraper.isEmpty()) {
-      if(entry.cacheId == resource.cacheId) {
-	matchingResources.append(resource);
-      }
-    } else {
-      if(entry.cacheId == resource.cacheId && resource.source == scraper) {
-	matchingResources.append(resource);
-      }
+  for(const auto &resource: resources.value(entry.cacheId)) {
+    if(scraper.isEmpty() || resource.source == scraper) {
+      matchingResources.append(resource);
     }
   }
 
@@ -1830,11 +2449,7 @@ void Cache::fillBlanks(GameEntry &entry, const QString scraper)
     QString result = "";
     QString source = "";
     if(fillType(type, matchingResources, result, source)) {
-      QFile f(cacheDir.absolutePath() + "/" + result);
-      if(f.open(QIODevice::ReadOnly)) {
-	entry.coverData = f.readAll();
-	f.close();
-      }
+      entry.setMediaFile(COVER, cacheDir.absolutePath() + "/" + result);
       entry.coverSrc = source;
     }
   }
@@ -1843,11 +2458,7 @@ void Cache::fillBlanks(GameEntry &entry, const QString scraper)
     QString result = "";
     QString source = "";
     if(fillType(type, matchingResources, result, source)) {
-      QFile f(cacheDir.absolutePath() + "/" + result);
-      if(f.open(QIODevice::ReadOnly)) {
-	entry.screenshotData = f.readAll();
-	f.close();
-      }
+      entry.setMediaFile(SCREENSHOT, cacheDir.absolutePath() + "/" + result);
       entry.screenshotSrc = source;
     }
   }
@@ -1856,11 +2467,7 @@ void Cache::fillBlanks(GameEntry &entry, const QString scraper)
     QString result = "";
     QString source = "";
     if(fillType(type, matchingResources, result, source)) {
-      QFile f(cacheDir.absolutePath() + "/" + result);
-      if(f.open(QIODevice::ReadOnly)) {
-	entry.wheelData = f.readAll();
-	f.close();
-      }
+      entry.setMediaFile(WHEEL, cacheDir.absolutePath() + "/" + result);
       entry.wheelSrc = source;
     }
   }
@@ -1869,11 +2476,7 @@ void Cache::fillBlanks(GameEntry &entry, const QString scraper)
     QString result = "";
     QString source = "";
     if(fillType(type, matchingResources, result, source)) {
-      QFile f(cacheDir.absolutePath() + "/" + result);
-      if(f.open(QIODevice::ReadOnly)) {
-	entry.marqueeData = f.readAll();
-	f.close();
-      }
+      entry.setMediaFile(MARQUEE, cacheDir.absolutePath() + "/" + result);
       entry.marqueeSrc = source;
     }
   }
@@ -1883,10 +2486,8 @@ void Cache::fillBlanks(GameEntry &entry, const QString scraper)
     QString source = "";
     if(fillType(type, matchingResources, result, source)) {
       QFileInfo info(cacheDir.absolutePath() + "/" + result);
-      QFile f(info.absoluteFilePath());
-      if(f.open(QIODevice::ReadOnly)) {
-	entry.videoData = f.readAll();
-	f.close();
+      if(info.isReadable()) {
+	entry.setMediaFile(VIDEO, info.absoluteFilePath());
 	entry.videoFormat = info.suffix();
 	entry.videoFile = info.absoluteFilePath();
 	entry.videoSrc = source;
@@ -1918,13 +2519,70 @@ bool Cache::fillType(QString &type, QList<Resource> &matchingResources,
       }
     }
   }
-  qint64 newest = 0;
+  // Ties go to the source that sorts first, so the result doesn't depend on the order of the
+  // resources in the hash
+  const Resource *newest = nullptr;
   for(const auto &resource: typeResources) {
-    if(resource.timestamp >= newest) {
-      newest = resource.timestamp;
-      result = resource.value;
-      source = resource.source;
+    if(newest == nullptr || resource.timestamp > newest->timestamp ||
+       (resource.timestamp == newest->timestamp && resource.source < newest->source)) {
+      newest = &resource;
     }
-  }  
+  }
+  result = newest->value;
+  source = newest->source;
   return true;
 }
+
+QString Cache::intern(const QString &str)
+{
+  QSet<QString>::const_iterator it = internedStrings.constFind(str);
+  if(it != internedStrings.constEnd()) {
+    return *it;
+  }
+  internedStrings.insert(str);
+  return str;
+}
+
+void Cache::insertResource(Resource resource)
+{
+  // Types and sources repeat for every rom, so share a single copy of each
+  resource.type = intern(resource.type);
+  resource.source = intern(resource.source);
+  QHash<QString, ResourceMap>::iterator idIt = resources.find(resource.cacheId);
+  if(idIt == resources.end()) {
+    idIt = resources.insert(resource.cacheId, ResourceMap());
+  }
+  resource.cacheId = idIt.key();
+  idIt.value().insert(qMakePair(resource.type, resource.source), resource);
+}
+
+// The resources sorted by cache id, type and source. The hashes they are kept in are seeded per
+// process, so without this every write would shuffle the cache files
+QList<const Resource *> Cache::getSortedResources()
+{
+  QList<const Resource *> sorted;
+  sorted.reserve(getResourceCount());
+  QList<QString> cacheIds = resources.keys();
+  std::sort(cacheIds.begin(), cacheIds.end());
+  for(const auto &cacheId: cacheIds) {
+    const ResourceMap &cacheIdResources = resources.constFind(cacheId).value();
+    QList<QPair<QString, QString> > keys = cacheIdResources.keys();
+    std::sort(keys.begin(), keys.end());
+    for(const auto &key: keys) {
+      sorted.append(&cacheIdResources.constFind(key).value());
+    }
+  }
+  return sorted;
+}
+
+int Cache::getResourceCount()
+{
+  int count = 0;
+  for(const auto &cacheIdResources: resources) {
+    count += cacheIdResources.size();
+  }
+  for(const auto &range: binIndex) {
+    count += range.second;
+  }
+  return count;
+}
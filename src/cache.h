@@ -29,8 +29,12 @@
 #include <QObject>
 #include <QString>
 #include <QMutex>
+#include <QFile>
 #include <QDirIterator>
 #include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QPair>
 #include <QSharedPointer>
 
 #include "gameentry.h"
@@ -64,10 +68,33 @@ struct ResCounts {
   int videos;
 };
 
+// Identifies a rom file on disk independently of its path
+struct QuickIdKey {
+  quint64 device = 0;
+  quint64 inode = 0;
+  qint64 size = 0;
+  qint64 modified = 0;
+};
+
+inline bool operator==(const QuickIdKey &a, const QuickIdKey &b)
+{
+  return a.inode == b.inode && a.device == b.device &&
+    a.size == b.size && a.modified == b.modified;
+}
+
+inline uint qHash(const QuickIdKey &key, uint seed = 0)
+{
+  return qHash(key.inode, seed) ^ qHash(key.device) ^ qHash(key.size) ^ qHash(key.modified);
+}
+
+// All resources for a single cache id, keyed by (type, source)
+typedef QHash<QPair<QString, QString>, Resource> ResourceMap;
+
 class Cache
 {
 public:
   Cache(const QString &cacheFolder);
+  ~Cache();
   bool createFolders(const QString &scraper);
   bool read();
   void printPriorities(QString cacheId);
@@ -88,8 +115,10 @@ public:
   bool hasEntries(const QString &cacheId, const QString scraper = "");
   void addQuickId(const QFileInfo &info, const QString &cacheId);
   QString getQuickId(const QFileInfo &info);
+  QString getCacheId(const QFileInfo &info);
+  void prepareCacheIds(const QList<QFileInfo> &fileInfos, const bool allDigests = false);
   void merge(Cache &mergeCache, bool overwrite, const QString &mergeCacheFolder);
-  QList<Resource> getResources();
+  bool convert(const QString &format);
 
  private:
   QDir cacheDir;
@@ -100,13 +129,52 @@ public:
 
   QMap<QString, ResCounts> resCountsMap;
 
-  QList<Resource> resources;
-  QMap<QString, QPair<qint64, QString> > quickIds; // filePath, timestamp + cacheId for quick lookup
+  QHash<QString, ResourceMap> resources; // cacheId -> (type, source) -> resource
+  QSet<QString> internedStrings; // Shared type and source strings
+
+  // Binary database (db.bin) state. Records stay in the mapped file until a cache id is needed
+  bool binaryDb = true;
+  QFile binFile;
+  uchar *binData = nullptr;
+  quint32 binStringCount = 0;
+  quint32 binRecordCount = 0;
+  qint64 binBlobSize = 0;
+  QHash<QString, QPair<quint32, quint32> > binIndex; // cacheId -> first record + record count
+
+  // Write-ahead journal (db.journal) with resources added since the database was last written
+  QFile journalFile;
+  int journalCount = 0;
+  int journalUnsynced = 0;
+  bool unjournaled = false; // Changes that aren't in the journal, forces a full write
+  QHash<QuickIdKey, QString> quickIds; // File identity -> cacheId for quick lookup
+  QHash<QPair<quint64, quint64>, QuickIdKey> quickIdFiles; // (device, inode) -> current key
 
   QList<QFileInfo> getFileInfos(const QString &inputFolder, const QString &filter, const bool subdirs = true);
   QList<QString> getCacheIdList(const QList<QFileInfo> &fileInfos);
 
   void addToResCounts(const QString source, const QString type);
+  QString intern(const QString &str);
+  void insertResource(Resource resource);
+  int getResourceCount();
+  QList<const Resource *> getSortedResources();
+  QuickIdKey getQuickIdKey(const QFileInfo &info);
+  void insertQuickId(const QuickIdKey &key, const QString &cacheId);
+  void removeQuickIds(const QSet<QString> &cacheIds);
+  void readQuickIds();
+  void readLegacyQuickIds();
+  bool writeQuickIds();
+  bool readXml();
+  bool readBinary();
+  bool writeXml();
+  bool writeBinary();
+  void closeBinary();
+  QString binString(const quint32 &index);
+  void materialize(const QString &cacheId);
+  void materializeAll();
+  bool replayJournal();
+  void appendJournal(const Resource &resource);
+  bool syncJournal();
+  void removeJournal();
   void addResource(Resource &resource, GameEntry &entry, const QString &cacheAbsolutePath,
 		   const Settings &config, QString &output);
   void verifyFiles(QDirIterator &dirIt, int &filesDeleted, int &noDelete, QString resType);
@@ -28,31 +28,33 @@
 #include <QPainter>
 #include <QDomDocument>
 #include <QFileInfo>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <utility>
 
 #include "compositor.h"
 #include "strtools.h"
 #include "imgtools.h"
+#include "filetools.h"
 
-#include "fxshadow.h"
-#include "fxblur.h"
-#include "fxmask.h"
-#include "fxframe.h"
-#include "fxrounded.h"
-#include "fxstroke.h"
-#include "fxbrightness.h"
-#include "fxcontrast.h"
-#include "fxbalance.h"
-#include "fxopacity.h"
-#include "fxgamebox.h"
-#include "fxhue.h"
-#include "fxsaturation.h"
-#include "fxcolorize.h"
-#include "fxrotate.h"
-#include "fxscanlines.h"
-
-Compositor::Compositor(Settings *config)
+Compositor::Compositor(Settings *config, QThreadPool *pool)
 {
   this->config = config;
+  this->pool = (pool != nullptr?pool:QThreadPool::globalInstance());
+
+  for(int a = 0; a < T_TYPES; ++a) {
+    stepFunctions[a] = nullptr;
+  }
+  stepFunctions[T_SHADOW] = &Compositor::applyShadow;
+  stepFunctions[T_BLUR] = &Compositor::applyBlur;
+  stepFunctions[T_MASK] = &Compositor::applyMask;
+  stepFunctions[T_FRAME] = &Compositor::applyFrame;
+  stepFunctions[T_STROKE] = &Compositor::applyStroke;
+  stepFunctions[T_ROUNDED] = &Compositor::applyRounded;
+  stepFunctions[T_GAMEBOX] = &Compositor::applyGamebox;
+  stepFunctions[T_ROTATE] = &Compositor::applyRotate;
+  stepFunctions[T_SCANLINES] = &Compositor::applyScanlines;
+  stepFunctions[T_COLORS] = &Compositor::applyColors;
 }
 
 bool Compositor::processXml()
@@ -69,11 +71,101 @@ bool Compositor::processXml()
   // Init recursive parsing
   addChildLayers(newOutputs, xml);
 
-  // Assign global outputs to these new outputs
-  outputs = newOutputs;
+  // Compile the layer tree into a flat render plan that is used for every game
+  plan.clear();
+  for(auto output: newOutputs.getLayers()) {
+    RenderOutput renderOutput;
+    renderOutput.hasLayers = output.hasLayers();
+    compileLayers(output, renderOutput.steps);
+    output.clearLayers();
+    renderOutput.layer = output;
+    plan.append(renderOutput);
+  }
   return true;
 }
 
+QList<RenderOutput> Compositor::getPlan()
+{
+  return plan;
+}
+
+void Compositor::setPlan(const QList<RenderOutput> &plan)
+{
+  this->plan = plan;
+}
+
+void Compositor::compileLayers(Layer &layer, QList<RenderStep> &steps)
+{
+  for(auto child: layer.getLayers()) {
+    // Adjacent color effects are folded into a single pass over the pixels
+    if(FxColors::isColorEffect(child.type)) {
+      if(steps.isEmpty() || steps.last().type != T_COLORS) {
+	RenderStep colorsStep;
+	colorsStep.type = T_COLORS;
+	steps.append(colorsStep);
+      }
+      steps.last().colors.addEffect(child);
+      continue;
+    }
+
+    RenderStep step;
+    step.type = child.type;
+    step.layer = child;
+    step.layer.clearLayers();
+    if(child.type == T_LAYER) {
+      // Layers that don't use game media look the same for every game, so prepare them now
+      if(child.resource == "") {
+	QImage emptyCanvas(1, 1, QImage::Format_ARGB32_Premultiplied);
+	emptyCanvas.fill(Qt::transparent);
+	step.layer.setCanvas(emptyCanvas);
+	step.prepared = true;
+      } else if(child.resource != "cover" &&
+		child.resource != "screenshot" &&
+		child.resource != "wheel" &&
+		child.resource != "marquee") {
+	step.layer.setCanvas(config->resources.value(child.resource));
+	step.prepared = true;
+      }
+      if(step.prepared) {
+	// This branch would never be drawn, so leave it out of the plan
+	if(step.layer.canvas.isNull()) {
+	  continue;
+	}
+	prepareLayer(step.layer);
+      }
+      int index = steps.length();
+      steps.append(step);
+      compileLayers(child, steps);
+      RenderStep drawStep;
+      drawStep.type = T_DRAW;
+      steps.append(drawStep);
+      steps[index].end = steps.length();
+      continue;
+    }
+    if(child.type == T_MASK || child.type == T_FRAME) {
+      step.asset = config->resources.value(child.resource).convertToFormat(QImage::Format_ARGB32_Premultiplied);
+      if(child.width == -1 && child.height != -1) {
+	step.asset = step.asset.scaledToHeight(child.height, Qt::SmoothTransformation);
+      } else if(child.width != -1 && child.height == -1) {
+	step.asset = step.asset.scaledToWidth(child.width, Qt::SmoothTransformation);
+      } else if(child.width != -1 && child.height != -1) {
+	step.asset = step.asset.scaled(child.width, child.height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+      }
+    } else if(child.type == T_SCANLINES) {
+      step.asset = fxScanlines.getScanlines(child, config);
+    }
+    // Update width and height only for effects that change the dimensions in a way that
+    // necessitates an update. For instance T_SHADOW does NOT require an update since we don't
+    // want the alignment of the layer to take the shadow into consideration.
+    step.resize = (child.type == T_STROKE ||
+		   child.type == T_ROTATE ||
+		   child.type == T_GAMEBOX);
+    if(step.type >= 0 && step.type < T_TYPES && stepFunctions[step.type] != nullptr) {
+      steps.append(step);
+    }
+  }
+}
+
 void Compositor::addChildLayers(Layer &layer, QXmlStreamReader &xml)
 {
   while(xml.readNext() && !xml.atEnd()) {
@@ -134,6 +226,8 @@ void Compositor::addChildLayers(Layer &layer, QXmlStreamReader &xml)
 	newLayer.setDistance(attribs.value("distance").toInt());
 	newLayer.setSoftness(attribs.value("softness").toInt());
 	newLayer.setOpacity(attribs.value("opacity").toInt());
+	if(attribs.hasAttribute("type"))
+	  newLayer.setGaussian(attribs.value("type").toString());
 	layer.addLayer(newLayer);
       }
     } else if(xml.isStartElement() && xml.name() == "blur") {
@@ -141,6 +235,8 @@ void Compositor::addChildLayers(Layer &layer, QXmlStreamReader &xml)
       if(attribs.hasAttribute("softness")) {
 	newLayer.setType(T_BLUR);
 	newLayer.setSoftness(attribs.value("softness").toInt());
+	if(attribs.hasAttribute("type"))
+	  newLayer.setGaussian(attribs.value("type").toString());
 	layer.addLayer(newLayer);
       }
     } else if(xml.isStartElement() && xml.name() == "mask") {
@@ -294,9 +390,15 @@ void Compositor::addChildLayers(Layer &layer, QXmlStreamReader &xml)
   }
 }
 
-void Compositor::saveAll(GameEntry &game, QString completeBaseName)
+// Outputs don't depend on each other, so each of them is rendered, encoded and written to disk
+// as its own job in the compositing pool. Outputs that are skipped or exported directly from
+// the cache are handled right away. Use finishAll() to wait for the rest
+QList<SavedOutput> Compositor::saveAll(GameEntry &game, QString completeBaseName)
 {
-  for(auto &output: outputs.getLayers()) {
+  images.clear();
+  QList<SavedOutput> outputs;
+  for(const auto &renderOutput: plan) {
+    Layer output = renderOutput.layer;
     QString filename = "/" + completeBaseName + ".png";
     if(output.resType == "cover") {
       filename.prepend(config->coversFolder);
@@ -324,171 +426,259 @@ void Compositor::saveAll(GameEntry &game, QString completeBaseName)
       }
     }
 
+    // Artwork that isn't modified in any way is exported directly from the cache if it already is a png
+    QString mediaFile = "";
     if(output.resource == "cover") {
-      output.setCanvas(QImage::fromData(game.coverData));
+      mediaFile = game.getMediaFile(COVER);
     } else if(output.resource == "screenshot") {
-      output.setCanvas(QImage::fromData(game.screenshotData));
+      mediaFile = game.getMediaFile(SCREENSHOT);
     } else if(output.resource == "wheel") {
-      output.setCanvas(QImage::fromData(game.wheelData));
+      mediaFile = game.getMediaFile(WHEEL);
     } else if(output.resource == "marquee") {
-      output.setCanvas(QImage::fromData(game.marqueeData));
+      mediaFile = game.getMediaFile(MARQUEE);
     }
-
-    if(output.canvas.isNull() && output.hasLayers()) {
-      QImage tmpImage(10, 10, QImage::Format_ARGB32_Premultiplied);
-      output.setCanvas(tmpImage);
+    if(!mediaFile.isEmpty() && !renderOutput.hasLayers &&
+       output.width == -1 && output.height == -1 && output.mPixels == -1.0 &&
+       FileTools::isPng(mediaFile) &&
+       FileTools::exportFile(mediaFile, filename, config->hardlink)) {
+      setOutputFile(game, output.resType, filename);
+      continue;
     }
 
-    output.premultiply();
-    output.scale();
-    
-    if(output.hasLayers()) {
-      // Reset output.canvas since composite layers exist
-      output.makeTransparent();
-      // Initiate recursive compositing
-      processChildLayers(game, output);
+    // Several outputs of the same type write the same file, let the last one win like before
+    for(auto &previous: outputs) {
+      if(previous.filename == filename) {
+	previous.saved.waitForFinished();
+      }
     }
 
-    if(output.resType == "cover" && output.save(filename)) {
-      game.coverFile = filename;
-    } else if(output.resType == "screenshot" && output.save(filename)) {
-      game.screenshotFile = filename;
-    } else if(output.resType == "wheel" && output.save(filename)) {
-      game.wheelFile = filename;
-    } else if(output.resType == "marquee" && output.save(filename)) {
-      game.marqueeFile = filename;
+    // The job gets its own implicitly shared copy of the game, so the caller is free to keep
+    // working on it while the job runs
+    SavedOutput saved;
+    saved.resType = output.resType;
+    saved.filename = filename;
+    saved.saved = QtConcurrent::run(pool, [this, game, output, renderOutput, filename]() mutable {
+	if(output.resource == "cover" ||
+	   output.resource == "screenshot" ||
+	   output.resource == "wheel" ||
+	   output.resource == "marquee") {
+	  output.setCanvas(getImage(game, output.resource));
+	}
+
+	if(output.canvas.isNull() && renderOutput.hasLayers) {
+	  QImage tmpImage(10, 10, QImage::Format_ARGB32_Premultiplied);
+	  output.setCanvas(tmpImage);
+	}
+
+	output.premultiply();
+	output.scale();
+
+	if(renderOutput.hasLayers) {
+	  // Reset output.canvas since composite layers exist
+	  output.makeTransparent();
+	  render(game, output, renderOutput.steps);
+	}
+
+	return output.save(filename);
+      });
+    outputs.append(saved);
+  }
+  return outputs;
+}
+
+// Waits for all outputs started by saveAll() and sets the files of those that were saved
+void Compositor::finishAll(GameEntry &game, QList<SavedOutput> &outputs)
+{
+  for(auto &output: outputs) {
+    output.saved.waitForFinished();
+    if(output.saved.result()) {
+      setOutputFile(game, output.resType, output.filename);
     }
   }
 }
 
-void Compositor::processChildLayers(GameEntry &game, Layer &layer)
+void Compositor::setOutputFile(GameEntry &game, const QString &resType, const QString &filename)
 {
-  for(int a = 0; a < layer.getLayers().length(); ++a) {
-    // Create new layer and set canvas to relevant resource (or empty if left out in xml)
-    Layer thisLayer = layer.getLayers().at(a);
-    if(thisLayer.type == T_LAYER) {
-      if(thisLayer.resource == "") {
-	QImage emptyCanvas(1, 1, QImage::Format_ARGB32_Premultiplied);
-	emptyCanvas.fill(Qt::transparent);
-	thisLayer.setCanvas(emptyCanvas);
-      } else if(thisLayer.resource == "cover") {
-	thisLayer.setCanvas(QImage::fromData(game.coverData));
-      } else if(thisLayer.resource == "screenshot") {
-	  thisLayer.setCanvas(QImage::fromData(game.screenshotData));
-      } else if(thisLayer.resource == "wheel") {
-	  thisLayer.setCanvas(QImage::fromData(game.wheelData));
-      } else if(thisLayer.resource == "marquee") {
-	  thisLayer.setCanvas(QImage::fromData(game.marqueeData));
-      } else {
-	thisLayer.setCanvas(config->resources[thisLayer.resource]);
-      }
-	  
-      // If no meaningful canvas could be created, stop processing this layer branch entirely
-      if(thisLayer.canvas.isNull()) {
-	continue;
+  if(resType == "cover") {
+    game.coverFile = filename;
+  } else if(resType == "screenshot") {
+    game.screenshotFile = filename;
+  } else if(resType == "wheel") {
+    game.wheelFile = filename;
+  } else if(resType == "marquee") {
+    game.marqueeFile = filename;
+  }
+}
+
+void Compositor::render(GameEntry &game, Layer &output, const QList<RenderStep> &steps)
+{
+  // The topmost layer is the one the effects currently work on
+  QList<Layer> stack;
+  stack.append(Layer());
+  std::swap(stack.first(), output);
+
+  int a = 0;
+  while(a < steps.length()) {
+    const RenderStep &step = steps.at(a);
+    if(step.type == T_LAYER) {
+      Layer thisLayer = step.layer;
+      if(!step.prepared) {
+	thisLayer.setCanvas(getImage(game, thisLayer.resource));
+	// If no meaningful canvas could be created, stop processing this layer branch entirely
+	if(thisLayer.canvas.isNull()) {
+	  a = step.end;
+	  continue;
+	}
+	prepareLayer(thisLayer);
       }
-      
-      thisLayer.premultiply();
-      if(thisLayer.resource == "screenshot") {
-	// Crop away transparency and, if configured, black borders around screenshots
-	thisLayer.setCanvas(ImgTools::cropToFit(thisLayer.canvas, config->cropBlack));
-      } else {
-	// Crop away transparency around all other types. Never crop black on these as many
-	// have black outlines that are very much needed
-	thisLayer.setCanvas(ImgTools::cropToFit(thisLayer.canvas));
+      stack.append(thisLayer);
+    } else if(step.type == T_DRAW) {
+      Layer thisLayer = stack.takeLast();
+      drawLayer(stack.last(), thisLayer);
+    } else {
+      (this->*stepFunctions[step.type])(game, stack.last(), step);
+      if(step.resize) {
+	stack.last().updateSize();
       }
-      thisLayer.scale();
+    }
+    a++;
+  }
 
-      // Update width + height as we will need them for easier placement and alignment
-      thisLayer.updateSize();
+  std::swap(output, stack.first());
+}
 
-      // Continue concurrency if this layer has children
-      if(thisLayer.hasLayers()) {
-	processChildLayers(game, thisLayer);
-      }
+void Compositor::prepareLayer(Layer &layer)
+{
+  layer.premultiply();
+  if(layer.resource == "screenshot") {
+    // Crop away transparency and, if configured, black borders around screenshots
+    layer.setCanvas(ImgTools::cropToFit(layer.canvas, config->cropBlack));
+  } else {
+    // Crop away transparency around all other types. Never crop black on these as many
+    // have black outlines that are very much needed
+    layer.setCanvas(ImgTools::cropToFit(layer.canvas));
+  }
+  layer.scale();
 
-      // Composite image on canvas (which is the parent canvas at this point)
-      QPainter painter;
-      painter.begin(&layer.canvas);
-      painter.setCompositionMode(thisLayer.mode);
-      if(thisLayer.opacity != -1)
-	painter.setOpacity(thisLayer.opacity * 0.01);
-
-      int x = 0;
-      if(thisLayer.align == "center") {
-	x = (layer.width / 2) - (thisLayer.width / 2);
-      } else if(thisLayer.align == "right") {
-	x = layer.width - thisLayer.width;
-      }
-      x += thisLayer.x;
+  // Update width + height as we will need them for easier placement and alignment
+  layer.updateSize();
+}
 
-      int y = 0;
-      if(thisLayer.valign == "middle") {
-	y = (layer.height / 2) - (thisLayer.height / 2);
-      } else if(thisLayer.valign == "bottom") {
-	y = layer.height - thisLayer.height;
-      }
-      y += thisLayer.y;
-
-      painter.drawImage(x, y, thisLayer.canvas);
-      painter.end();
-      
-    } else if(thisLayer.type == T_SHADOW) {
-      FxShadow effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer));
-    } else if(thisLayer.type == T_BLUR) {
-      FxBlur effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer));
-    } else if(thisLayer.type == T_MASK) {
-      FxMask effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer, config));
-    } else if(thisLayer.type == T_FRAME) {
-      FxFrame effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer, config));
-    } else if(thisLayer.type == T_STROKE) {
-      FxStroke effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer));
-    } else if(thisLayer.type == T_ROUNDED) {
-      FxRounded effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer));
-    } else if(thisLayer.type == T_BRIGHTNESS) {
-      FxBrightness effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer));
-    } else if(thisLayer.type == T_CONTRAST) {
-      FxContrast effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer));
-    } else if(thisLayer.type == T_BALANCE) {
-      FxBalance effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer));
-    } else if(thisLayer.type == T_OPACITY) {
-      FxOpacity effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer));
-    } else if(thisLayer.type == T_GAMEBOX) {
-      FxGamebox effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer, game, config));
-    } else if(thisLayer.type == T_HUE) {
-      FxHue effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer));
-    } else if(thisLayer.type == T_SATURATION) {
-      FxSaturation effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer));
-    } else if(thisLayer.type == T_COLORIZE) {
-      FxColorize effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer));
-    } else if(thisLayer.type == T_ROTATE) {
-      FxRotate effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer));
-    } else if(thisLayer.type == T_SCANLINES) {
-      FxScanlines effect;
-      layer.setCanvas(effect.applyEffect(layer.canvas, thisLayer, config));
-    }
-    // Update width and height only for effects that change the dimensions in a way that
-    // necessitates an update. For instance T_SHADOW does NOT require an update since we don't
-    // want the alignment of the layer to take the shadow into consideration.
-    if(thisLayer.type == T_STROKE ||
-       thisLayer.type == T_ROTATE ||
-       thisLayer.type == T_GAMEBOX) {
-      layer.updateSize();
-    }
+void Compositor::drawLayer(Layer &layer, const Layer &thisLayer)
+{
+  // Composite image on canvas (which is the parent canvas at this point)
+  QPainter painter;
+  painter.begin(&layer.canvas);
+  painter.setCompositionMode(thisLayer.mode);
+  if(thisLayer.opacity != -1)
+    painter.setOpacity(thisLayer.opacity * 0.01);
+
+  int x = 0;
+  if(thisLayer.align == "center") {
+    x = (layer.width / 2) - (thisLayer.width / 2);
+  } else if(thisLayer.align == "right") {
+    x = layer.width - thisLayer.width;
+  }
+  x += thisLayer.x;
+
+  int y = 0;
+  if(thisLayer.valign == "middle") {
+    y = (layer.height / 2) - (thisLayer.height / 2);
+  } else if(thisLayer.valign == "bottom") {
+    y = layer.height - thisLayer.height;
+  }
+  y += thisLayer.y;
+
+  painter.drawImage(x, y, thisLayer.canvas);
+  painter.end();
+}
+
+void Compositor::applyShadow(GameEntry &, Layer &layer, const RenderStep &step)
+{
+  layer.setCanvas(fxShadow.applyEffect(layer.canvas, step.layer));
+}
+
+void Compositor::applyBlur(GameEntry &, Layer &layer, const RenderStep &step)
+{
+  layer.setCanvas(fxBlur.applyEffect(layer.canvas, step.layer));
+}
+
+void Compositor::applyMask(GameEntry &, Layer &layer, const RenderStep &step)
+{
+  layer.setCanvas(fxMask.applyEffect(layer.canvas, step.layer, step.asset));
+}
+
+void Compositor::applyFrame(GameEntry &, Layer &layer, const RenderStep &step)
+{
+  layer.setCanvas(fxFrame.applyEffect(layer.canvas, step.layer, step.asset));
+}
+
+void Compositor::applyStroke(GameEntry &, Layer &layer, const RenderStep &step)
+{
+  layer.setCanvas(fxStroke.applyEffect(layer.canvas, step.layer));
+}
+
+void Compositor::applyRounded(GameEntry &, Layer &layer, const RenderStep &step)
+{
+  layer.setCanvas(fxRounded.applyEffect(layer.canvas, step.layer));
+}
+
+void Compositor::applyGamebox(GameEntry &game, Layer &layer, const RenderStep &step)
+{
+  layer.setCanvas(fxGamebox.applyEffect(layer.canvas, step.layer, getImage(game, step.layer.resource), config));
+}
+
+void Compositor::applyRotate(GameEntry &, Layer &layer, const RenderStep &step)
+{
+  layer.setCanvas(fxRotate.applyEffect(layer.canvas, step.layer));
+}
+
+void Compositor::applyScanlines(GameEntry &, Layer &layer, const RenderStep &step)
+{
+  layer.setCanvas(fxScanlines.applyEffect(layer.canvas, step.layer, step.asset));
+}
+
+void Compositor::applyColors(GameEntry &, Layer &layer, const RenderStep &step)
+{
+  if(!step.colors.isEmpty()) {
+    layer.setCanvas(step.colors.applyEffect(layer.canvas));
+  }
+}
+
+QImage Compositor::getImage(GameEntry &game, const QString &resource)
+{
+  int type = -1;
+  if(resource == "cover") {
+    type = COVER;
+  } else if(resource == "screenshot") {
+    type = SCREENSHOT;
+  } else if(resource == "wheel") {
+    type = WHEEL;
+  } else if(resource == "marquee") {
+    type = MARQUEE;
+  } else {
+    return config->resources.value(resource);
+  }
+  QMutexLocker locker(&imageMutex);
+  // Outputs that need an image another output is decoding wait for it instead of decoding it
+  // again. The default artwork uses the cover in more than one output, for instance
+  while(decoding.contains(resource)) {
+    imageDecoded.wait(&imageMutex);
+  }
+  if(!images.contains(resource)) {
+    // Decode without holding the lock, so outputs using other images aren't held up
+    decoding.insert(resource);
+    locker.unlock();
+    QElapsedTimer decodeTimer;
+    decodeTimer.start();
+    QImage image = QImage::fromData(game.getMediaData(type)).convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    qint64 elapsed = decodeTimer.nsecsElapsed();
+    locker.relock();
+    decodeTime += elapsed;
+    decodes++;
+    images[resource] = image;
+    decoding.remove(resource);
+    imageDecoded.wakeAll();
   }
+  return images.value(resource);
 }
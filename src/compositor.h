@@ -28,25 +28,110 @@
 
 #include <QImage>
 #include <QXmlStreamReader>
+#include <QThreadPool>
+#include <QFuture>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSet>
 
 #include "settings.h"
 #include "gameentry.h"
 #include "layer.h"
 
+#include "fxshadow.h"
+#include "fxblur.h"
+#include "fxmask.h"
+#include "fxframe.h"
+#include "fxrounded.h"
+#include "fxstroke.h"
+#include "fxgamebox.h"
+#include "fxrotate.h"
+#include "fxscanlines.h"
+#include "fxcolors.h"
+
+// One instruction of a compiled render plan. Layers push a canvas that the following
+// effects work on, until a T_DRAW composites it onto the canvas below it
+struct RenderStep
+{
+  int type = T_NONE;
+  Layer layer; // Attributes from artwork.xml, without the nested layers
+  bool prepared = false; // T_LAYER canvas doesn't depend on the game and is already prepared
+  int end = 0; // For T_LAYER, the step after the matching T_DRAW
+  bool resize = false; // Effect changes the size used for aligning the layer
+  QImage asset; // Static mask, frame or scanlines image, converted and scaled up front
+  FxColors colors; // For T_COLORS
+};
+
+struct RenderOutput
+{
+  Layer layer; // Attributes from artwork.xml, without the nested layers
+  bool hasLayers = false;
+  QList<RenderStep> steps;
+};
+
+// An output that is being rendered and saved in the compositing pool
+struct SavedOutput
+{
+  QString resType;
+  QString filename;
+  QFuture<bool> saved;
+};
+
 class Compositor : public QObject
 {
   Q_OBJECT
 
 public:
-  Compositor(Settings *config);
+  Compositor(Settings *config, QThreadPool *pool = nullptr);
   bool processXml();
-  void saveAll(GameEntry &game, QString completeBaseName);
+  QList<RenderOutput> getPlan();
+  void setPlan(const QList<RenderOutput> &plan);
+  QList<SavedOutput> saveAll(GameEntry &game, QString completeBaseName);
+  static void finishAll(GameEntry &game, QList<SavedOutput> &outputs);
+
+  int decodes = 0;
+  qint64 decodeTime = 0; // In ns
 
 private:
   void addChildLayers(Layer &layer, QXmlStreamReader &xml);
-  void processChildLayers(GameEntry &game, Layer &layer);
+  void compileLayers(Layer &layer, QList<RenderStep> &steps);
+  void render(GameEntry &game, Layer &output, const QList<RenderStep> &steps);
+  void prepareLayer(Layer &layer);
+  void drawLayer(Layer &layer, const Layer &thisLayer);
+  QImage getImage(GameEntry &game, const QString &resource);
+  static void setOutputFile(GameEntry &game, const QString &resType, const QString &filename);
   Settings *config;
-  Layer outputs;
+  QThreadPool *pool;
+  QList<RenderOutput> plan;
+  // Game media decoded and premultiplied once per game. Outputs, layers and effects all
+  // get implicitly shared copies of these
+  QMap<QString, QImage> images;
+  QMutex imageMutex; // Outputs are rendered in parallel and share the decoded images
+  QSet<QString> decoding; // Images that are being decoded by one of the outputs
+  QWaitCondition imageDecoded;
+
+  // Effects are dispatched through this table, indexed by layer type
+  typedef void (Compositor::*StepFunction)(GameEntry &game, Layer &layer, const RenderStep &step);
+  StepFunction stepFunctions[T_TYPES];
+  void applyShadow(GameEntry &game, Layer &layer, const RenderStep &step);
+  void applyBlur(GameEntry &game, Layer &layer, const RenderStep &step);
+  void applyMask(GameEntry &game, Layer &layer, const RenderStep &step);
+  void applyFrame(GameEntry &game, Layer &layer, const RenderStep &step);
+  void applyStroke(GameEntry &game, Layer &layer, const RenderStep &step);
+  void applyRounded(GameEntry &game, Layer &layer, const RenderStep &step);
+  void applyGamebox(GameEntry &game, Layer &layer, const RenderStep &step);
+  void applyRotate(GameEntry &game, Layer &layer, const RenderStep &step);
+  void applyScanlines(GameEntry &game, Layer &layer, const RenderStep &step);
+  void applyColors(GameEntry &game, Layer &layer, const RenderStep &step);
+  FxShadow fxShadow;
+  FxBlur fxBlur;
+  FxMask fxMask;
+  FxFrame fxFrame;
+  FxStroke fxStroke;
+  FxRounded fxRounded;
+  FxGamebox fxGamebox;
+  FxRotate fxRotate;
+  FxScanlines fxScanlines;
 
 };
 
@@ -23,19 +23,58 @@ SOFTWARE.
 */
 #include "crc32.h"
 
+#include <QtEndian>
+
+// Slice-by-8 lookup tables, table 0 is the classic byte-at-a-time table
+static const quint32 (&crcTables())[8][256]
+{
+  static quint32 tables[8][256];
+  static bool initialized = [] {
+    for(int i = 0; i < 256; i++) {
+      quint32 crc = i;
+      for(int j = 0; j < 8; j++) {
+	crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1;
+      }
+      tables[0][i] = crc;
+    }
+    for(int i = 0; i < 256; i++) {
+      for(int t = 1; t < 8; t++) {
+	tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+      }
+    }
+    return true;
+  }();
+  Q_UNUSED(initialized);
+  return tables;
+}
+
 Crc32::Crc32()
 {
-  quint32 crc;
+  // Make sure the shared tables are built before any threads start pushing data
+  crcTables();
+}
 
-  // initialize CRC table
-  for (int i = 0; i < 256; i++) {
-    crc = i;
-    for (int j = 0; j < 8; j++) {
-      crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1;
-    }
-    
-    crc_table[i] = crc;
+quint32 Crc32::update(quint32 crc, const char *data, qint64 len)
+{
+  const quint32 (&table)[8][256] = crcTables();
+  const uchar *bytes = (const uchar *)data;
+
+  // Process 8 bytes per iteration, the tables are little endian so the words are too
+  while(len >= 8) {
+    quint32 one = qFromLittleEndian<quint32>(bytes) ^ crc;
+    quint32 two = qFromLittleEndian<quint32>(bytes + 4);
+    crc =
+      table[7][one & 0xFF] ^ table[6][(one >> 8) & 0xFF] ^
+      table[5][(one >> 16) & 0xFF] ^ table[4][one >> 24] ^
+      table[3][two & 0xFF] ^ table[2][(two >> 8) & 0xFF] ^
+      table[1][(two >> 16) & 0xFF] ^ table[0][two >> 24];
+    bytes += 8;
+    len -= 8;
   }
+  while(len-- > 0) {
+    crc = table[0][(crc ^ *bytes++) & 0xFF] ^ (crc >> 8);
+  }
+  return crc;
 }
 
 void Crc32::initInstance(int i)
@@ -43,26 +82,17 @@ void Crc32::initInstance(int i)
   instances[i] = 0xFFFFFFFFUL;
 }
 
-void Crc32::pushData(int i, char *data, int len)
+void Crc32::pushData(int i, const char *data, qint64 len)
 {
-  quint32 crc = instances[i];
-  if(crc) {
-    for(int j = 0; j < len; j++) {
-      crc = crc_table[(crc ^ data[j]) & 0xFF] ^ (crc >> 8);
-    }
-    
-    instances[i] = crc;
+  if(instances.contains(i)) {
+    instances[i] = update(instances.value(i), data, len);
   }
 }
 
 quint32 Crc32::releaseInstance(int i)
 {
-  quint32 crc32 = instances[i];
-  if (crc32) {
-    instances.remove(i);
-    return crc32 ^ 0xFFFFFFFFUL;
-  }
-  else {
-    return 0;
+  if(instances.contains(i)) {
+    return instances.take(i) ^ 0xFFFFFFFFUL;
   }
+  return 0;
 }
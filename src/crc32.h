@@ -31,16 +31,15 @@ SOFTWARE.
 class Crc32
 {
 private:
-    quint32 crc_table[256];
     QMap<int, quint32> instances;
 
 public:
     Crc32();
 
-    quint32 calculateFromFile(QString filename);
+    static quint32 update(quint32 crc, const char *data, qint64 len);
 
     void initInstance(int i);
-    void pushData(int i, char *data, int len);
+    void pushData(int i, const char *data, qint64 len);
     quint32 releaseInstance(int i);
 };
 
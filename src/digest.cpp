@@ -0,0 +1,149 @@
+/***************************************************************************
+ *            digest.cpp
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <QFile>
+
+#include "digest.h"
+#include "crc32.h"
+
+// Large reads keep syscalls down, the data is then fed to the digests in blocks small
+// enough to stay in the cpu cache while all three of them run over it
+constexpr int READSIZE = 1024 * 1024;
+constexpr int BLOCKSIZE = 64 * 1024;
+
+QMutex Digest::memoMutex;
+QHash<QString, DigestMemo> Digest::memos;
+
+Digest::Digest(const bool allDigests)
+  : allDigests(allDigests), md5Hash(QCryptographicHash::Md5), sha1Hash(QCryptographicHash::Sha1)
+{
+}
+
+void Digest::addData(const char *data, qint64 len)
+{
+  while(len > 0) {
+    int block = (int)qMin(len, (qint64)BLOCKSIZE);
+    sha1Hash.addData(data, block);
+    if(allDigests) {
+      md5Hash.addData(data, block);
+      crc = Crc32::update(crc, data, block);
+    }
+    data += block;
+    len -= block;
+  }
+}
+
+bool Digest::addFile(const QString &fileName)
+{
+  QFile file(fileName);
+  if(!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  // Map the whole file if possible, otherwise fall back to large reads
+  qint64 size = file.size();
+  uchar *data = (size > 0 ? file.map(0, size) : nullptr);
+  if(data != nullptr) {
+    addData((const char *)data, size);
+    file.unmap(data);
+  } else {
+    QByteArray buffer(READSIZE, Qt::Uninitialized);
+    qint64 bytesRead = 0;
+    while((bytesRead = file.read(buffer.data(), buffer.size())) > 0) {
+      addData(buffer.constData(), bytesRead);
+    }
+    if(bytesRead < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Digests the stdout of an already started process as it arrives instead of buffering it all.
+// The timeout applies to each wait for new data. Returns false if the process couldn't be
+// started, timed out or didn't exit cleanly with exit code 0, since the digest is incomplete then
+bool Digest::addProcessOutput(QProcess &process, const int timeout)
+{
+  if(!process.waitForStarted(timeout)) {
+    return false;
+  }
+  process.setReadChannel(QProcess::StandardOutput);
+  QByteArray buffer(READSIZE, Qt::Uninitialized);
+  while(true) {
+    qint64 bytesRead = process.read(buffer.data(), buffer.size());
+    if(bytesRead > 0) {
+      addData(buffer.constData(), bytesRead);
+      continue;
+    }
+    if(process.state() == QProcess::NotRunning) {
+      break;
+    }
+    if(!process.waitForReadyRead(timeout) && process.state() != QProcess::NotRunning) {
+      process.kill();
+      process.waitForFinished();
+      return false;
+    }
+  }
+  return (process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0);
+}
+
+QString Digest::crc32()
+{
+  return QString("%1").arg(crc ^ 0xFFFFFFFFUL, 8, 16, QChar('0'));
+}
+
+QString Digest::md5()
+{
+  return md5Hash.result().toHex();
+}
+
+QString Digest::sha1()
+{
+  return sha1Hash.result().toHex();
+}
+
+// Keeps the digests of a rom around so the scraper doesn't have to read it again
+void Digest::remember(const QFileInfo &info, Digest &digest)
+{
+  DigestMemo memo;
+  memo.size = info.size();
+  memo.modified = info.lastModified().toMSecsSinceEpoch();
+  memo.crc32 = digest.crc32();
+  memo.md5 = digest.md5();
+  memo.sha1 = digest.sha1();
+  QMutexLocker locker(&memoMutex);
+  memos.insert(info.absoluteFilePath(), memo);
+}
+
+// Hands over remembered digests once, as long as the file hasn't changed since
+bool Digest::recall(const QFileInfo &info, DigestMemo &memo)
+{
+  QMutexLocker locker(&memoMutex);
+  if(!memos.contains(info.absoluteFilePath())) {
+    return false;
+  }
+  memo = memos.take(info.absoluteFilePath());
+  return memo.size == info.size() &&
+    memo.modified == info.lastModified().toMSecsSinceEpoch();
+}
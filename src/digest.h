@@ -0,0 +1,71 @@
+/***************************************************************************
+ *            digest.h
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <QString>
+#include <QFileInfo>
+#include <QProcess>
+#include <QCryptographicHash>
+#include <QMutex>
+#include <QHash>
+
+struct DigestMemo
+{
+  qint64 size = 0;
+  qint64 modified = 0;
+  QString crc32;
+  QString md5;
+  QString sha1;
+};
+
+// Calculates CRC32, MD5 and SHA1 of the same data in a single streaming pass
+class Digest
+{
+public:
+  Digest(const bool allDigests = true);
+  void addData(const char *data, qint64 len);
+  bool addFile(const QString &fileName);
+  bool addProcessOutput(QProcess &process, const int timeout);
+  QString crc32();
+  QString md5();
+  QString sha1();
+
+  static void remember(const QFileInfo &info, Digest &digest);
+  static bool recall(const QFileInfo &info, DigestMemo &memo);
+
+private:
+  bool allDigests;
+  quint32 crc = 0xFFFFFFFFUL;
+  QCryptographicHash md5Hash;
+  QCryptographicHash sha1Hash;
+
+  static QMutex memoMutex;
+  static QHash<QString, DigestMemo> memos;
+
+};
+
+#endif // DIGEST_H
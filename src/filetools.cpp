@@ -0,0 +1,162 @@
+/***************************************************************************
+ *            filetools.cpp
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <QtGlobal>
+#include <QFile>
+
+#if defined(Q_OS_UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+#if defined(Q_OS_LINUX)
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#endif
+
+#include "filetools.h"
+
+constexpr qint64 CHUNKSIZE = 1024 * 1024;
+
+// Exports a cached media file without ever holding the whole file in memory. Tries a
+// hardlink (if requested), then a reflink or in-kernel copy and finally a chunked copy
+bool FileTools::exportFile(const QString &src, const QString &dst, const bool hardlink)
+{
+  if(QFile::exists(dst) && !QFile::remove(dst)) {
+    return false;
+  }
+#if defined(Q_OS_UNIX)
+  if(hardlink &&
+     link(QFile::encodeName(src).constData(), QFile::encodeName(dst).constData()) == 0) {
+    return true;
+  }
+#else
+  Q_UNUSED(hardlink);
+#endif
+  if(cloneFile(src, dst)) {
+    return true;
+  }
+  return copyChunked(src, dst);
+}
+
+bool FileTools::isPng(const QString &fileName)
+{
+  QFile f(fileName);
+  if(!f.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  return f.read(8) == QByteArray("\x89PNG\r\n\x1a\n", 8);
+}
+
+bool FileTools::getFileId(const QString &fileName, quint64 &device, quint64 &inode)
+{
+#if defined(Q_OS_UNIX)
+  struct stat info;
+  if(stat(QFile::encodeName(fileName).constData(), &info) == 0) {
+    device = info.st_dev;
+    inode = info.st_ino;
+    return true;
+  }
+#else
+  Q_UNUSED(fileName);
+  Q_UNUSED(device);
+  Q_UNUSED(inode);
+#endif
+  return false;
+}
+
+bool FileTools::cloneFile(const QString &src, const QString &dst)
+{
+#if defined(Q_OS_LINUX)
+  int in = open(QFile::encodeName(src).constData(), O_RDONLY | O_CLOEXEC);
+  if(in == -1) {
+    return false;
+  }
+  struct stat info;
+  if(fstat(in, &info) == -1) {
+    close(in);
+    return false;
+  }
+  int out = open(QFile::encodeName(dst).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if(out == -1) {
+    close(in);
+    return false;
+  }
+  bool success = false;
+#ifdef FICLONE
+  // Reflink on copy-on-write filesystems such as btrfs and xfs, no data is copied at all
+  success = (ioctl(out, FICLONE, in) == 0);
+#endif
+#ifdef __NR_copy_file_range
+  // In-kernel copy, the data never passes through userspace. Called through syscall()
+  // since older C libraries don't provide a wrapper
+  if(!success) {
+    qint64 remaining = info.st_size;
+    while(remaining > 0) {
+      long copied = syscall(__NR_copy_file_range, in, NULL, out, NULL,
+			    (size_t)qMin(remaining, CHUNKSIZE * 64), 0);
+      if(copied <= 0) {
+	break;
+      }
+      remaining -= copied;
+    }
+    success = (remaining == 0);
+  }
+#endif
+  close(out);
+  close(in);
+  if(!success) {
+    QFile::remove(dst);
+  }
+  return success;
+#else
+  Q_UNUSED(src);
+  Q_UNUSED(dst);
+  return false;
+#endif
+}
+
+bool FileTools::copyChunked(const QString &src, const QString &dst)
+{
+  QFile in(src);
+  QFile out(dst);
+  if(!in.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  if(!out.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+  while(!in.atEnd()) {
+    QByteArray chunk = in.read(CHUNKSIZE);
+    if(chunk.isEmpty() || out.write(chunk) != chunk.size()) {
+      out.close();
+      out.remove();
+      return false;
+    }
+  }
+  return true;
+}
@@ -1,8 +1,8 @@
 /***************************************************************************
- *            fxcolorize.h
+ *            filetools.h
  *
- *  Sat Feb 3 12:00:00 CEST 2018
- *  Copyright 2018 Lars Muldjord
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
  *  muldjordlars@gmail.com
  ****************************************************************************/
 /*
@@ -23,24 +23,23 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
  */
 
-#ifndef FXCOLORIZE_H
-#define FXCOLORIZE_H
+#ifndef FILETOOLS_H
+#define FILETOOLS_H
 
-#include <QImage>
+#include <QObject>
+#include <QString>
 
-#include "layer.h"
-
-class FxColorize : public QObject
+class FileTools : public QObject
 {
-  Q_OBJECT
-
 public:
-  FxColorize();
-  QImage applyEffect(const QImage &src, const Layer &layer);
+  static bool exportFile(const QString &src, const QString &dst, const bool hardlink = false);
+  static bool isPng(const QString &fileName);
+  static bool getFileId(const QString &fileName, quint64 &device, quint64 &inode);
 
 private:
-  int truncate(int value);
+  static bool cloneFile(const QString &src, const QString &dst);
+  static bool copyChunked(const QString &src, const QString &dst);
 
 };
 
-#endif // FXCOLORIZE_H
+#endif // FILETOOLS_H
@@ -0,0 +1,107 @@
+/***************************************************************************
+ *            fixturestore.cpp
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QCryptographicHash>
+
+#include "fixturestore.h"
+
+constexpr quint32 FIXTUREMAGIC = 0x534b5946; // "SKYF"
+constexpr quint8 FIXTUREVERSION = 1;
+constexpr qint64 FIXTURECHUNKSIZE = 1024 * 1024;
+
+FixtureStore::FixtureStore(const QString &folder)
+  : folder(folder)
+{
+  QDir().mkpath(folder);
+}
+
+// The key holds the full url including any credentials, so only its hash is written to disk
+QString FixtureStore::getFileName(const QString &key)
+{
+  return folder + "/" + QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+}
+
+bool FixtureStore::load(const QString &key, BatchRequest &result)
+{
+  QFile fixtureFile(getFileName(key));
+  if(!fixtureFile.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QDataStream in(&fixtureFile);
+  in.setVersion(QDataStream::Qt_5_0);
+  quint32 magic = 0;
+  quint8 version = 0;
+  qint32 error = 0;
+  qint32 status = 0;
+  in >> magic >> version;
+  if(magic != FIXTUREMAGIC || version != FIXTUREVERSION) {
+    return false;
+  }
+  in >> error >> status >> result.contentType >> result.redirUrl >> result.data;
+  if(in.status() != QDataStream::Ok) {
+    return false;
+  }
+  result.error = (QNetworkReply::NetworkError)error;
+  result.status = status;
+  result.size = result.data.size();
+  return true;
+}
+
+void FixtureStore::save(const QString &key, const BatchRequest &result)
+{
+  QSaveFile fixtureFile(getFileName(key));
+  if(!fixtureFile.open(QIODevice::WriteOnly)) {
+    return;
+  }
+  QDataStream out(&fixtureFile);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << FIXTUREMAGIC << FIXTUREVERSION;
+  out << (qint32)result.error << (qint32)result.status << result.contentType << result.redirUrl;
+  if(result.fileName.isEmpty()) {
+    out << result.data;
+    fixtureFile.commit();
+    return;
+  }
+  // Streamed replies are only on disk and can be large videos, so they are copied over in
+  // chunks. The length prefix is the same one QDataStream writes for a QByteArray
+  QFile streamedFile(result.fileName);
+  if(!streamedFile.open(QIODevice::ReadOnly) || streamedFile.size() >= 0xffffffff) {
+    fixtureFile.cancelWriting();
+    return;
+  }
+  out << (quint32)streamedFile.size();
+  QByteArray chunk;
+  while(!(chunk = streamedFile.read(FIXTURECHUNKSIZE)).isEmpty()) {
+    if(fixtureFile.write(chunk) != chunk.size()) {
+      fixtureFile.cancelWriting();
+      return;
+    }
+  }
+  fixtureFile.commit();
+}
@@ -1,8 +1,8 @@
 /***************************************************************************
- *            fxbalance.h
+ *            fixturestore.h
  *
- *  Sat Feb 3 12:00:00 CEST 2018
- *  Copyright 2018 Lars Muldjord
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
  *  muldjordlars@gmail.com
  ****************************************************************************/
 /*
@@ -23,24 +23,28 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
  */
 
-#ifndef FXBALANCE_H
-#define FXBALANCE_H
+#ifndef FIXTURESTORE_H
+#define FIXTURESTORE_H
 
-#include <QImage>
+#include <QString>
 
-#include "layer.h"
+#include "netmanager.h"
 
-class FxBalance : public QObject
+// Request and reply pairs recorded to a folder, so the scraping modules can be run again later
+// against the exact same answers without using the network. Used for benchmarking and for
+// reproducing problems
+class FixtureStore
 {
-  Q_OBJECT
-
 public:
-  FxBalance();
-  QImage applyEffect(const QImage &src, const Layer &layer);
+  FixtureStore(const QString &folder);
+  bool load(const QString &key, BatchRequest &result);
+  void save(const QString &key, const BatchRequest &result);
 
 private:
-  int truncate(int value);
+  QString getFileName(const QString &key);
+
+  QString folder;
 
 };
 
-#endif // FXBALANCE_H
+#endif // FIXTURESTORE_H
@@ -41,11 +41,6 @@ public:
   FxBlur();
   QImage applyEffect(const QImage &src, const Layer &layer);
 
-private:
-  void boxBlur(QRgb *buffer1, QRgb *buffer2, int width, int height, int radius);
-  void boxBlurHorizontal(QRgb *buffer1, QRgb *buffer2, int width, int height, int radius);
-  void boxBlurTotal(QRgb *buffer1, QRgb *buffer2, int width, int height, int radius);
-
 };
 
 #endif // FXBLUR_H
@@ -0,0 +1,395 @@
+/***************************************************************************
+ *            fxcolors.cpp
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "fxcolors.h"
+
+// Same rounding as qPremultiply(), exact for alpha 255
+static inline int mulAlpha(const int &value, const int &alpha)
+{
+  int t = value * alpha;
+  return (t + (t >> 8) + 0x80) >> 8;
+}
+
+#if defined(__AVX2__)
+static inline __m256i mulAlpha(const __m256i &values, const __m256i &alphas)
+{
+  __m256i t = _mm256_mullo_epi16(values, alphas);
+  t = _mm256_add_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), _mm256_set1_epi16(0x80));
+  return _mm256_srli_epi16(t, 8);
+}
+
+static inline __m256i premultiply(const __m256i &pixels)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i lo = _mm256_unpacklo_epi8(pixels, zero);
+  __m256i hi = _mm256_unpackhi_epi8(pixels, zero);
+  __m256i loAlpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+  __m256i hiAlpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+  __m256i result = _mm256_packus_epi16(mulAlpha(lo, loAlpha), mulAlpha(hi, hiAlpha));
+  // Keep the original alpha
+  const __m256i alphaMask = _mm256_set1_epi32(0xff000000);
+  return _mm256_or_si256(_mm256_andnot_si256(alphaMask, result), _mm256_and_si256(alphaMask, pixels));
+}
+#elif defined(__SSE2__)
+static inline __m128i mulAlpha(const __m128i &values, const __m128i &alphas)
+{
+  __m128i t = _mm_mullo_epi16(values, alphas);
+  t = _mm_add_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), _mm_set1_epi16(0x80));
+  return _mm_srli_epi16(t, 8);
+}
+
+static inline __m128i premultiply(const __m128i &pixels)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i lo = _mm_unpacklo_epi8(pixels, zero);
+  __m128i hi = _mm_unpackhi_epi8(pixels, zero);
+  __m128i loAlpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+  __m128i hiAlpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+  __m128i result = _mm_packus_epi16(mulAlpha(lo, loAlpha), mulAlpha(hi, hiAlpha));
+  // Keep the original alpha
+  const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+  return _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(alphaMask, pixels));
+}
+#elif defined(__ARM_NEON)
+static inline uint8x8_t mulAlpha(const uint8x8_t &values, const uint8x8_t &alphas)
+{
+  uint16x8_t t = vmull_u8(values, alphas);
+  t = vaddq_u16(t, vshrq_n_u16(t, 8));
+  return vaddhn_u16(t, vdupq_n_u16(0x80));
+}
+
+static inline uint8x16_t premultiply(const uint8x16_t &pixels)
+{
+  // Copy each pixel's alpha into all four of its bytes
+  uint8x16_t alphas = vreinterpretq_u8_u32(vmulq_n_u32(vshrq_n_u32(vreinterpretq_u32_u8(pixels), 24), 0x01010101));
+  uint8x16_t result = vcombine_u8(mulAlpha(vget_low_u8(pixels), vget_low_u8(alphas)),
+				  mulAlpha(vget_high_u8(pixels), vget_high_u8(alphas)));
+  // Keep the original alpha
+  return vbslq_u8(vreinterpretq_u8_u32(vdupq_n_u32(0xff000000)), pixels, result);
+}
+#endif
+
+// Brightness and balance. Equal to qPremultiply(qRgba(clamp(r + delta), ..., alpha))
+static void addChannels(QRgb *pixels, const int &count, const QRgb &add, const QRgb &sub)
+{
+  int a = 0;
+#if defined(__AVX2__)
+  const __m256i addVector = _mm256_set1_epi32(add);
+  const __m256i subVector = _mm256_set1_epi32(sub);
+  for(; a + 8 <= count; a += 8) {
+    __m256i p = _mm256_loadu_si256((const __m256i *)(pixels + a));
+    p = _mm256_subs_epu8(_mm256_adds_epu8(p, addVector), subVector);
+    _mm256_storeu_si256((__m256i *)(pixels + a), premultiply(p));
+  }
+#elif defined(__SSE2__)
+  const __m128i addVector = _mm_set1_epi32(add);
+  const __m128i subVector = _mm_set1_epi32(sub);
+  for(; a + 4 <= count; a += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i *)(pixels + a));
+    p = _mm_subs_epu8(_mm_adds_epu8(p, addVector), subVector);
+    _mm_storeu_si128((__m128i *)(pixels + a), premultiply(p));
+  }
+#elif defined(__ARM_NEON)
+  const uint8x16_t addVector = vreinterpretq_u8_u32(vdupq_n_u32(add));
+  const uint8x16_t subVector = vreinterpretq_u8_u32(vdupq_n_u32(sub));
+  for(; a + 4 <= count; a += 4) {
+    uint8x16_t p = vld1q_u8((const uint8_t *)(pixels + a));
+    p = vqsubq_u8(vqaddq_u8(p, addVector), subVector);
+    vst1q_u8((uint8_t *)(pixels + a), premultiply(p));
+  }
+#endif
+  for(; a < count; ++a) {
+    int alpha = qAlpha(pixels[a]);
+    int red = qBound(0, qRed(pixels[a]) + qRed(add) - qRed(sub), 255);
+    int green = qBound(0, qGreen(pixels[a]) + qGreen(add) - qGreen(sub), 255);
+    int blue = qBound(0, qBlue(pixels[a]) + qBlue(add) - qBlue(sub), 255);
+    pixels[a] = qRgba(mulAlpha(red, alpha), mulAlpha(green, alpha), mulAlpha(blue, alpha), alpha);
+  }
+}
+
+// Opacity. Scales all four channels, like drawing the image with QPainter::setOpacity()
+static void mulChannels(QRgb *pixels, const int &count, const int &opacity)
+{
+  int a = 0;
+#if defined(__AVX2__)
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i opacityVector = _mm256_set1_epi16(opacity);
+  for(; a + 8 <= count; a += 8) {
+    __m256i p = _mm256_loadu_si256((const __m256i *)(pixels + a));
+    p = _mm256_packus_epi16(mulAlpha(_mm256_unpacklo_epi8(p, zero), opacityVector),
+			    mulAlpha(_mm256_unpackhi_epi8(p, zero), opacityVector));
+    _mm256_storeu_si256((__m256i *)(pixels + a), p);
+  }
+#elif defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i opacityVector = _mm_set1_epi16(opacity);
+  for(; a + 4 <= count; a += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i *)(pixels + a));
+    p = _mm_packus_epi16(mulAlpha(_mm_unpacklo_epi8(p, zero), opacityVector),
+			 mulAlpha(_mm_unpackhi_epi8(p, zero), opacityVector));
+    _mm_storeu_si128((__m128i *)(pixels + a), p);
+  }
+#elif defined(__ARM_NEON)
+  const uint8x8_t opacityVector = vdup_n_u8(opacity);
+  for(; a + 4 <= count; a += 4) {
+    uint8x16_t p = vld1q_u8((const uint8_t *)(pixels + a));
+    p = vcombine_u8(mulAlpha(vget_low_u8(p), opacityVector),
+		    mulAlpha(vget_high_u8(p), opacityVector));
+    vst1q_u8((uint8_t *)(pixels + a), p);
+  }
+#endif
+  for(; a < count; ++a) {
+    pixels[a] = qRgba(mulAlpha(qRed(pixels[a]), opacity),
+		      mulAlpha(qGreen(pixels[a]), opacity),
+		      mulAlpha(qBlue(pixels[a]), opacity),
+		      mulAlpha(qAlpha(pixels[a]), opacity));
+  }
+}
+
+// Sets the channels from a hue in degrees and the largest and smallest channel
+static inline void setHue(int hue, const int &max, const int &min, int &red, int &green, int &blue)
+{
+  int sector = hue / 60;
+  int rising = min + ((max - min) * (hue % 60) + 30) / 60;
+  int falling = max - ((max - min) * (hue % 60) + 30) / 60;
+  switch(sector) {
+  case 0:
+    red = max; green = rising; blue = min;
+    break;
+  case 1:
+    red = falling; green = max; blue = min;
+    break;
+  case 2:
+    red = min; green = max; blue = rising;
+    break;
+  case 3:
+    red = min; green = falling; blue = max;
+    break;
+  case 4:
+    red = rising; green = min; blue = max;
+    break;
+  default:
+    red = max; green = min; blue = falling;
+  }
+}
+
+bool FxColors::isColorEffect(const int &type)
+{
+  return (type == T_BRIGHTNESS ||
+	  type == T_CONTRAST ||
+	  type == T_BALANCE ||
+	  type == T_OPACITY ||
+	  type == T_HUE ||
+	  type == T_SATURATION ||
+	  type == T_COLORIZE);
+}
+
+void FxColors::addEffect(const Layer &layer)
+{
+  ColorStage stage;
+  stage.type = layer.type;
+  if(layer.type == T_BRIGHTNESS || layer.type == T_BALANCE) {
+    int red = layer.delta, green = layer.delta, blue = layer.delta;
+    if(layer.type == T_BALANCE) {
+      red = layer.red;
+      green = layer.green;
+      blue = layer.blue;
+    }
+    stage.add = qRgba(qBound(0, red, 255), qBound(0, green, 255), qBound(0, blue, 255), 0);
+    stage.sub = qRgba(qBound(0, -red, 255), qBound(0, -green, 255), qBound(0, -blue, 255), 0);
+  } else if(layer.type == T_CONTRAST) {
+    QVector<int> lut(3 * 256);
+    double factor = (259.0 * ((double)layer.delta + 255.0)) / (255.0 * (259.0 - (double)layer.delta));
+    for(int a = 0; a < 256; ++a) {
+      lut[a] = lut[256 + a] = lut[512 + a] = truncate(round(factor * a));
+    }
+    // Fold into the previous stage if that is a contrast as well
+    if(!stages.isEmpty() && stages.last().type == T_CONTRAST) {
+      ColorStage &previous = stages.last();
+      previous.luts.append(lut);
+      for(int a = 0; a < 3 * 256; ++a) {
+	previous.combined[a] = lut[(a / 256) * 256 + previous.combined[a]];
+      }
+      return;
+    }
+    stage.luts.append(lut);
+    stage.combined = lut;
+  } else if(layer.type == T_OPACITY) {
+    // Same alpha as QPainter uses for an opacity
+    stage.value = (qRound(qBound(0, layer.opacity, 100) / 100.0 * 256) * 255) >> 8;
+    if(stage.value == 255) {
+      return;
+    }
+  } else if(layer.type == T_HUE) {
+    // Out of range hues leave the image untouched
+    if(layer.delta > 359 || layer.delta < 0) {
+      return;
+    }
+    stage.delta = layer.delta;
+  } else if(layer.type == T_SATURATION) {
+    stage.delta = layer.delta;
+  } else if(layer.type == T_COLORIZE) {
+    if(layer.value > 359 || layer.value < 0) {
+      return;
+    }
+    int saturation = 127 + (layer.delta > 127 || layer.delta < -127?0:layer.delta);
+    // The color only depends on the lightness, so calculate all 256 of them up front
+    stage.colors.resize(256);
+    for(int lightness = 0; lightness < 256; ++lightness) {
+      int chroma = (255 - qAbs(2 * lightness - 255)) * saturation / 255;
+      int max = lightness + (chroma + 1) / 2;
+      int min = max - chroma;
+      int red = 0, green = 0, blue = 0;
+      setHue(layer.value, qMin(max, 255), qMax(min, 0), red, green, blue);
+      stage.colors[lightness] = qRgb(red, green, blue);
+    }
+  } else {
+    return;
+  }
+  stages.append(stage);
+}
+
+bool FxColors::isEmpty() const
+{
+  return stages.isEmpty();
+}
+
+QImage FxColors::applyEffect(const QImage &src) const
+{
+  QImage canvas = src.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+  for(int y = 0; y < canvas.height(); ++y) {
+    QRgb *line = (QRgb *)canvas.scanLine(y);
+    for(const auto &stage: stages) {
+      applyStage(stage, line, canvas.width());
+    }
+  }
+
+  return canvas;
+}
+
+void FxColors::applyStage(const ColorStage &stage, QRgb *pixels, const int &count) const
+{
+  if(stage.type == T_BRIGHTNESS || stage.type == T_BALANCE) {
+    addChannels(pixels, count, stage.add, stage.sub);
+  } else if(stage.type == T_OPACITY) {
+    mulChannels(pixels, count, stage.value);
+  } else if(stage.type == T_CONTRAST) {
+    const int *combined = stage.combined.constData();
+    for(int a = 0; a < count; ++a) {
+      QRgb pixel = pixels[a];
+      if(qAlpha(pixel) == 255) {
+	pixels[a] = qRgb(combined[qRed(pixel)],
+			 combined[256 + qGreen(pixel)],
+			 combined[512 + qBlue(pixel)]);
+	continue;
+      }
+      for(const auto &lut: stage.luts) {
+	pixel = qPremultiply(qRgba(lut[qRed(pixel)],
+				   lut[256 + qGreen(pixel)],
+				   lut[512 + qBlue(pixel)],
+				   qAlpha(pixel)));
+      }
+      pixels[a] = pixel;
+    }
+  } else if(stage.type == T_HUE) {
+    // Rotates the hue while keeping the HSV saturation and value, in integer math
+    for(int a = 0; a < count; ++a) {
+      int red = qRed(pixels[a]), green = qGreen(pixels[a]), blue = qBlue(pixels[a]);
+      int alpha = qAlpha(pixels[a]);
+      int max = qMax(red, qMax(green, blue));
+      int min = qMin(red, qMin(green, blue));
+      int chroma = max - min;
+      if(chroma != 0) {
+	// Hue in degrees times chroma, to keep the precision without floats
+	int hue = 0;
+	if(max == red) {
+	  hue = 60 * (green - blue);
+	  if(hue < 0) {
+	    hue += 360 * chroma;
+	  }
+	} else if(max == green) {
+	  hue = 60 * (blue - red) + 120 * chroma;
+	} else {
+	  hue = 60 * (red - green) + 240 * chroma;
+	}
+	hue = ((hue + stage.delta * chroma) % (360 * chroma) + chroma / 2) / chroma % 360;
+	setHue(hue, max, min, red, green, blue);
+      }
+      pixels[a] = qRgba(mulAlpha(red, alpha), mulAlpha(green, alpha), mulAlpha(blue, alpha), alpha);
+    }
+  } else if(stage.type == T_SATURATION) {
+    // Changes the HSL saturation while keeping the hue and lightness. With those fixed, every
+    // channel moves linearly away from or towards the lightness
+    for(int a = 0; a < count; ++a) {
+      int red = qRed(pixels[a]), green = qGreen(pixels[a]), blue = qBlue(pixels[a]);
+      int alpha = qAlpha(pixels[a]);
+      int max = qMax(red, qMax(green, blue));
+      int min = qMin(red, qMin(green, blue));
+      int chroma = max - min;
+      int range = 255 - qAbs(max + min - 255);
+      if(chroma != 0 && range != 0) {
+	int saturation = truncate((chroma * 255 + range / 2) / range + stage.delta);
+	int newChroma = (saturation * range + 127) / 255;
+	int sum = max + min;
+	red = truncate((sum + (2 * red - sum) * newChroma / chroma + 1) / 2);
+	green = truncate((sum + (2 * green - sum) * newChroma / chroma + 1) / 2);
+	blue = truncate((sum + (2 * blue - sum) * newChroma / chroma + 1) / 2);
+      }
+      pixels[a] = qRgba(mulAlpha(red, alpha), mulAlpha(green, alpha), mulAlpha(blue, alpha), alpha);
+    }
+  } else if(stage.type == T_COLORIZE) {
+    const QRgb *colors = stage.colors.constData();
+    for(int a = 0; a < count; ++a) {
+      // Same weights as before this was table based, red is weighted twice and blue not at all
+      int lightness = (qRed(pixels[a]) * 18665 + qGreen(pixels[a]) * 46871) >> 16;
+      QRgb color = colors[lightness];
+      int alpha = qAlpha(pixels[a]);
+      pixels[a] = qRgba(mulAlpha(qRed(color), alpha), mulAlpha(qGreen(color), alpha),
+			mulAlpha(qBlue(color), alpha), alpha);
+    }
+  }
+}
+
+int FxColors::truncate(int value) const
+{
+  if(value > 255) {
+    value = 255;
+  }
+  if(value < 0) {
+    value = 0;
+  }
+  return value;
+}
@@ -0,0 +1,69 @@
+/***************************************************************************
+ *            fxcolors.h
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#ifndef FXCOLORS_H
+#define FXCOLORS_H
+
+#include <QImage>
+#include <QList>
+#include <QVector>
+
+#include "layer.h"
+
+struct ColorStage
+{
+  int type = T_NONE;
+  int value = 0;
+  int delta = 0;
+  // Brightness and balance, per channel values added to or subtracted from the pixels
+  QRgb add = 0;
+  QRgb sub = 0;
+  // Contrast, one 3 * 256 entry table per effect, and all of them combined into one, which
+  // gives the same result for fully opaque pixels
+  QList<QVector<int> > luts;
+  QVector<int> combined;
+  // Colorize, the resulting color for each lightness
+  QVector<QRgb> colors;
+};
+
+// Applies a chain of adjacent per-pixel color effects in a single pass over the image. Each
+// row is run through all stages while it's in the cpu cache, and the stages that can be
+// vectorized use SSE2, AVX2 or NEON when the compiler targets them
+class FxColors
+{
+public:
+  static bool isColorEffect(const int &type);
+  void addEffect(const Layer &layer);
+  bool isEmpty() const;
+  QImage applyEffect(const QImage &src) const;
+
+private:
+  void applyStage(const ColorStage &stage, QRgb *pixels, const int &count) const;
+  int truncate(int value) const;
+  QList<ColorStage> stages;
+
+};
+
+#endif // FXCOLORS_H
@@ -32,21 +32,14 @@ FxFrame::FxFrame()
 {
 }
 
-QImage FxFrame::applyEffect(const QImage &src, const Layer &layer, Settings *config)
+// The frame is premultiplied and already scaled by the render plan, unless the layer has no
+// size. Then it's scaled to the size of the image it's applied to
+QImage FxFrame::applyEffect(const QImage &src, const Layer &layer, QImage frame)
 {
   QImage canvas = src;
 
-  QImage frame(config->resources[layer.resource]);
-  frame = frame.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-
   if(layer.width == -1 && layer.height == -1) {
     frame = frame.scaled(src.width(), src.height(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-  } else if(layer.width == -1 && layer.height != -1) {
-    frame = frame.scaledToHeight(layer.height, Qt::SmoothTransformation);
-  } else if(layer.width != -1 && layer.height == -1) {
-    frame = frame.scaledToWidth(layer.width, Qt::SmoothTransformation);
-  } else if(layer.width != -1 && layer.height != -1) {
-    frame = frame.scaled(layer.width, layer.height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
   }
 
   QPainter painter;
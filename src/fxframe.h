@@ -29,7 +29,6 @@
 #include <QImage>
 
 #include "layer.h"
-#include "settings.h"
 
 class FxFrame : public QObject
 {
@@ -37,7 +36,7 @@ class FxFrame : public QObject
 
 public:
   FxFrame();
-  QImage applyEffect(const QImage &src, const Layer &layer, Settings *config);
+  QImage applyEffect(const QImage &src, const Layer &layer, QImage frame);
 
 };
 
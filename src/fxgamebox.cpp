@@ -34,7 +34,7 @@ FxGamebox::FxGamebox()
 }
 
 QImage FxGamebox::applyEffect(const QImage &src, const Layer &layer,
-			      const GameEntry &game, Settings *config)
+			      QImage sideImage, Settings *config)
 {
   QPainter painter;
   QTransform trans;
@@ -59,18 +59,6 @@ QImage FxGamebox::applyEffect(const QImage &src, const Layer &layer,
 
   fillWithAvg(src, side);
 
-  QImage sideImage;
-  if(layer.resource == "cover") {
-    sideImage = QImage::fromData(game.coverData);
-  } else if(layer.resource == "screenshot") {
-    sideImage = QImage::fromData(game.screenshotData);
-  } else if(layer.resource == "wheel") {
-    sideImage = QImage::fromData(game.wheelData);
-  } else if(layer.resource == "marquee") {
-    sideImage = QImage::fromData(game.marqueeData);
-  } else {
-    sideImage = QImage(config->resources[layer.resource]);
-  }
   sideImage = sideImage.convertToFormat(QImage::Format_ARGB32_Premultiplied);
 
   trans.reset();
@@ -29,7 +29,6 @@
 #include <QImage>
 
 #include "layer.h"
-#include "gameentry.h"
 #include "settings.h"
 
 class FxGamebox : public QObject
@@ -38,7 +37,7 @@ class FxGamebox : public QObject
 
 public:
   FxGamebox();
-  QImage applyEffect(const QImage &src, const Layer &layer, const GameEntry &game, Settings *config);
+  QImage applyEffect(const QImage &src, const Layer &layer, QImage sideImage, Settings *config);
 
 private:
   void fillWithAvg(const QImage &src, QImage &dst);
@@ -32,21 +32,14 @@ FxMask::FxMask()
 {
 }
 
-QImage FxMask::applyEffect(const QImage &src, const Layer &layer, Settings *config)
+// The mask is premultiplied and already scaled by the render plan, unless the layer has no
+// size. Then it's scaled to the size of the image it's applied to
+QImage FxMask::applyEffect(const QImage &src, const Layer &layer, QImage mask)
 {
   QImage canvas = src;
 
-  QImage mask(config->resources[layer.resource]);
-  mask = mask.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-
   if(layer.width == -1 && layer.height == -1) {
     mask = mask.scaled(src.width(), src.height(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-  } else if(layer.width == -1 && layer.height != -1) {
-    mask = mask.scaledToHeight(layer.height, Qt::SmoothTransformation);
-  } else if(layer.width != -1 && layer.height == -1) {
-    mask = mask.scaledToWidth(layer.width, Qt::SmoothTransformation);
-  } else if(layer.width != -1 && layer.height != -1) {
-    mask = mask.scaled(layer.width, layer.height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
   }
 
   QPainter painter;
@@ -32,12 +32,11 @@ FxScanlines::FxScanlines()
 {
 }
 
-QImage FxScanlines::applyEffect(const QImage &src, const Layer &layer, Settings *config)
+// Resolves and scales the scanlines image once, when the render plan is compiled
+QImage FxScanlines::getScanlines(const Layer &layer, Settings *config)
 {
-  QImage canvas = src;
   QString resource = layer.resource;
   double scaling = 1.0;
-  int opacity = layer.opacity;
   if(!layer.scaling.isEmpty()) {
     bool isDouble = false;
     layer.scaling.toDouble(&isDouble);
@@ -45,38 +44,38 @@ QImage FxScanlines::applyEffect(const QImage &src, const Layer &layer, Settings
       scaling = layer.scaling.toDouble();
   }
 
-  if(resource.isEmpty() || !config->resources.contains("resource"))
+  if(resource.isEmpty() || !config->resources.contains(resource))
     resource = "scanlines1.png";
-  if(opacity == -1)
-    opacity = 100;
 
   if(scaling < 0.1)
     scaling = 0.1;
   if(scaling > 2.0)
     scaling = 2.0;
 
+  QImage scanlines = config->resources.value(resource);
+  if(scaling != 1.0) {
+    scanlines = scanlines.scaledToWidth((int)((double)scanlines.width() * scaling), Qt::FastTransformation);
+  }
+  return scanlines;
+}
+
+QImage FxScanlines::applyEffect(const QImage &src, const Layer &layer, const QImage &scanlines)
+{
+  QImage canvas = src;
+  int opacity = layer.opacity;
+
+  if(opacity == -1)
+    opacity = 100;
   if(opacity > 100)
     opacity = 100;
   if(opacity < 0)
     opacity = 0;
 
-  /*
-  if(!layer.scaling.isEmpty()) {
-    if(layer.scaling == "auto") {
-    } else {
-      bool isDouble = false;
-      layer.scaling.toDouble(&isDouble);
-      if(isDouble)
-	scaling = layer.scaling.toDouble();
-    }
-  }
-  */
-
   QPainter painter;
   painter.begin(&canvas);
   painter.setOpacity(opacity * 0.01);
   painter.setCompositionMode(layer.mode);
-  painter.drawImage(0, 0, (scaling != 1.0?config->resources[resource].scaledToWidth((int)((double)config->resources[resource].width() * scaling), Qt::FastTransformation):config->resources[resource]));
+  painter.drawImage(0, 0, scanlines);
   painter.end();
 
   return canvas;
@@ -37,7 +37,8 @@ class FxScanlines : public QObject
 
 public:
   FxScanlines();
-  QImage applyEffect(const QImage &src, const Layer &layer, Settings *config);
+  QImage getScanlines(const Layer &layer, Settings *config);
+  QImage applyEffect(const QImage &src, const Layer &layer, const QImage &scanlines);
 
 };
 
@@ -41,12 +41,6 @@ public:
   FxShadow();
   QImage applyEffect(const QImage &src, const Layer &layer);
 
-private:
-  QVector<double> getGaussBoxes(double sigma, double n);
-  void boxBlur(QRgb *buffer1, QRgb *buffer2, int width, int height, int radius);
-  void boxBlurHorizontal(QRgb *buffer1, QRgb *buffer2, int width, int height, int radius);
-  void boxBlurTotal(QRgb *buffer1, QRgb *buffer2, int width, int height, int radius);
-
 };
 
 #endif // FXSHADOW_H
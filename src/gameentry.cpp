@@ -23,6 +23,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
  */
 
+#include <QFile>
+
 #include "gameentry.h"
 
 GameEntry::GameEntry()
@@ -43,16 +45,16 @@ void GameEntry::calculateCompleteness(bool videoEnabled)
   if(platform.isEmpty()) {
     completeness -= valuePerType;
   }
-  if(coverData.isNull()) {
+  if(!hasMedia(COVER)) {
     completeness -= valuePerType;
   }
-  if(screenshotData.isNull()) {
+  if(!hasMedia(SCREENSHOT)) {
     completeness -= valuePerType;
   }
-  if(wheelData.isNull()) {
+  if(!hasMedia(WHEEL)) {
     completeness -= valuePerType;
   }
-  if(marqueeData.isNull()) {
+  if(!hasMedia(MARQUEE)) {
     completeness -= valuePerType;
   }
   if(description.isEmpty()) {
@@ -96,4 +98,48 @@ void GameEntry::resetMedia()
   wheelData = QByteArray();
   marqueeData = QByteArray();
   videoData = "";
+  mediaFiles.clear();
+}
+
+void GameEntry::setMediaFile(const int type, const QString &fileName)
+{
+  mediaData(type)->clear();
+  mediaFiles[type] = fileName;
+}
+
+QByteArray &GameEntry::getMediaData(const int type)
+{
+  QByteArray *data = mediaData(type);
+  if(mediaFiles.contains(type)) {
+    QFile f(mediaFiles.take(type));
+    if(f.open(QIODevice::ReadOnly)) {
+      *data = f.readAll();
+      f.close();
+    }
+  }
+  return *data;
+}
+
+QString GameEntry::getMediaFile(const int type)
+{
+  return mediaFiles.value(type);
+}
+
+bool GameEntry::hasMedia(const int type)
+{
+  return mediaFiles.contains(type) || !mediaData(type)->isNull();
+}
+
+QByteArray *GameEntry::mediaData(const int type)
+{
+  if(type == COVER) {
+    return &coverData;
+  } else if(type == SCREENSHOT) {
+    return &screenshotData;
+  } else if(type == WHEEL) {
+    return &wheelData;
+  } else if(type == MARQUEE) {
+    return &marqueeData;
+  }
+  return &videoData;
 }
@@ -42,6 +42,7 @@ constexpr int AGES = 12;
 constexpr int TITLE = 13;
 
 #include <QImage>
+#include <QMap>
 
 class GameEntry
 {
@@ -50,6 +51,10 @@ public:
   void calculateCompleteness(bool videoEnabled = false);
   int getCompleteness() const;
   void resetMedia();
+  void setMediaFile(const int type, const QString &fileName);
+  QByteArray &getMediaData(const int type);
+  QString getMediaFile(const int type);
+  bool hasMedia(const int type);
 
   QString id = "";
   QString path = "";
@@ -128,7 +133,11 @@ public:
   QList<QPair<QString, QString> > pSValuePairs;
 
 private:
+  QByteArray *mediaData(const int type);
+
   double completeness = 0;
+  // Media files from the resource cache that haven't been read into the '*Data' members yet
+  QMap<int, QString> mediaFiles;
   
 };
 
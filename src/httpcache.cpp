@@ -0,0 +1,130 @@
+/***************************************************************************
+ *            httpcache.cpp
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDir>
+#include <QDirIterator>
+#include <QDataStream>
+#include <QDateTime>
+#include <QMultiMap>
+#include <QCryptographicHash>
+
+#include "httpcache.h"
+
+constexpr quint32 HTTPCACHEMAGIC = 0x534b5948; // "SKYH"
+constexpr quint8 HTTPCACHEVERSION = 1;
+
+HttpCache::HttpCache(const QString &folder, const qint64 &maxSize)
+  : folder(folder), maxSize(maxSize)
+{
+  QDir().mkpath(folder);
+  QDirIterator it(folder, QDir::Files, QDirIterator::Subdirectories);
+  while(it.hasNext()) {
+    it.next();
+    totalSize += it.fileInfo().size();
+  }
+}
+
+// Entries are stored under a hash of the url, so credentials in query strings never end up on disk
+QString HttpCache::getFileName(const QUrl &url)
+{
+  QString hash = QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex();
+  return folder + "/" + hash.left(2) + "/" + hash;
+}
+
+bool HttpCache::lookup(const QUrl &url, HttpCacheEntry &entry)
+{
+  QMutexLocker locker(&cacheMutex);
+  QFile entryFile(getFileName(url));
+  if(!entryFile.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QDataStream in(&entryFile);
+  in.setVersion(QDataStream::Qt_5_0);
+  quint32 magic = 0;
+  quint8 version = 0;
+  in >> magic >> version;
+  if(magic != HTTPCACHEMAGIC || version != HTTPCACHEVERSION) {
+    return false;
+  }
+  in >> entry.eTag >> entry.lastModified >> entry.contentType >> entry.data;
+  if(in.status() != QDataStream::Ok) {
+    return false;
+  }
+#if QT_VERSION >= 0x050a00
+  // Mark the entry as recently used so it's evicted last
+  entryFile.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+#endif
+  return true;
+}
+
+void HttpCache::store(const QUrl &url, const HttpCacheEntry &entry)
+{
+  // Don't let a single reply push everything else out of the cache
+  if(entry.data.size() > maxSize / 20) {
+    return;
+  }
+  QMutexLocker locker(&cacheMutex);
+  QString fileName = getFileName(url);
+  QDir().mkpath(QFileInfo(fileName).absolutePath());
+  qint64 oldSize = QFileInfo(fileName).size();
+  QSaveFile entryFile(fileName);
+  if(!entryFile.open(QIODevice::WriteOnly)) {
+    return;
+  }
+  QDataStream out(&entryFile);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << HTTPCACHEMAGIC << HTTPCACHEVERSION;
+  out << entry.eTag << entry.lastModified << entry.contentType << entry.data;
+  qint64 newSize = entryFile.size();
+  if(!entryFile.commit()) {
+    return;
+  }
+  totalSize += newSize - oldSize;
+  if(totalSize > maxSize) {
+    evict();
+  }
+}
+
+// Removes the least recently used entries until the cache is down to 90% of the maximum size
+void HttpCache::evict()
+{
+  QMultiMap<QDateTime, QFileInfo> entries;
+  totalSize = 0;
+  QDirIterator it(folder, QDir::Files, QDirIterator::Subdirectories);
+  while(it.hasNext()) {
+    it.next();
+    entries.insert(it.fileInfo().lastModified(), it.fileInfo());
+    totalSize += it.fileInfo().size();
+  }
+  qint64 goal = maxSize * 9 / 10;
+  for(auto it = entries.constBegin(); it != entries.constEnd() && totalSize > goal; ++it) {
+    if(QFile::remove(it.value().absoluteFilePath())) {
+      totalSize -= it.value().size();
+    }
+  }
+}
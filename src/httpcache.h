@@ -1,8 +1,8 @@
 /***************************************************************************
- *            fxbrightness.h
+ *            httpcache.h
  *
- *  Sat Feb 3 12:00:00 CEST 2018
- *  Copyright 2018 Lars Muldjord
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
  *  muldjordlars@gmail.com
  ****************************************************************************/
 /*
@@ -23,24 +23,40 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
  */
 
-#ifndef FXBRIGHTNESS_H
-#define FXBRIGHTNESS_H
+#ifndef HTTPCACHE_H
+#define HTTPCACHE_H
 
-#include <QImage>
+#include <QString>
+#include <QByteArray>
+#include <QUrl>
+#include <QMutex>
 
-#include "layer.h"
-
-class FxBrightness : public QObject
+struct HttpCacheEntry
 {
-  Q_OBJECT
+  QByteArray eTag;
+  QByteArray lastModified;
+  QByteArray contentType;
+  QByteArray data;
+};
 
+// On-disk cache of http replies, shared by all threads. Entries are evicted least recently used
+// first once the total size exceeds the maximum
+class HttpCache
+{
 public:
-  FxBrightness();
-  QImage applyEffect(const QImage &src, const Layer &layer);
+  HttpCache(const QString &folder, const qint64 &maxSize);
+  bool lookup(const QUrl &url, HttpCacheEntry &entry);
+  void store(const QUrl &url, const HttpCacheEntry &entry);
 
 private:
-  int truncate(int value);
+  QString getFileName(const QUrl &url);
+  void evict();
+
+  QMutex cacheMutex;
+  QString folder;
+  qint64 maxSize;
+  qint64 totalSize = 0;
 
 };
 
-#endif // FXBRIGHTNESS_H
+#endif // HTTPCACHE_H
@@ -44,10 +44,8 @@ Igdb::Igdb(Settings *config,
   headers.append(clientIdHeader);
   headers.append(tokenHeader);
   
-  connect(&limitTimer, &QTimer::timeout, &limiter, &QEventLoop::quit);
-  limitTimer.setInterval(1100); // 1.1 second request limit set a bit above 1.0 as requested by the good folks at IGDB. Don't change! It will break the module stability.
-  limitTimer.setSingleShot(false);
-  limitTimer.start();
+  // IGDB allows 4 requests per second in total. Spread them evenly with a bit of headroom as requested by the good folks at IGDB. Don't change! It will break the module stability.
+  manager->setRateLimit("api.igdb.com", getRequestRate(4 / 1.1));
 
   baseUrl = "https://api.igdb.com/v4";
 
@@ -67,7 +65,6 @@ void Igdb::getSearchResults(QList<GameEntry> &gameEntries,
 				QString searchName, QString platform)
 {
   // Request list of games but don't allow re-releases ("game.version_parent = null")
-  limiter.exec();
   netComm->request(baseUrl + "/search/", "fields game.name,game.platforms.name; search \"" + searchName + "\"; where game != null & game.version_parent = null;", headers);
   q.exec();
   data = netComm->getData();
@@ -104,7 +101,6 @@ void Igdb::getSearchResults(QList<GameEntry> &gameEntries,
 
 void Igdb::getGameData(GameEntry &game)
 {
-  limiter.exec();
   netComm->request(baseUrl + "/games/", "fields age_ratings.rating,age_ratings.category,total_rating,cover.url,game_modes.slug,genres.name,screenshots.url,summary,release_dates.date,release_dates.region,release_dates.platform,involved_companies.company.name,involved_companies.developer,involved_companies.publisher; where id = " + game.id.split(";").first() + ";", headers);
   q.exec();
   data = netComm->getData();
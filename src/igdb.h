@@ -39,9 +39,6 @@ public:
   Igdb(Settings *config, QSharedPointer<NetManager> manager);
 
 private:
-  QTimer limitTimer;
-  QEventLoop limiter;
-
   QList<QPair<QString, QString > > headers;
   
   void getSearchResults(QList<GameEntry> &gameEntries,
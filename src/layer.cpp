@@ -25,6 +25,8 @@
 
 #include <math.h>
 
+#include <QSaveFile>
+
 #include "layer.h"
 
 Layer::Layer()
@@ -180,6 +182,11 @@ void Layer::setSoftness(const int &softness)
   this->softness = softness;
 }
 
+void Layer::setGaussian(const QString &type)
+{
+  gaussian = (type == "gaussian");
+}
+
 void Layer::setOpacity(const int &opacity)
 {
   if(opacity > 100)
@@ -200,6 +207,11 @@ QList<Layer> Layer::getLayers()
   return layers;
 }
 
+void Layer::clearLayers()
+{
+  layers.clear();
+}
+
 void Layer::makeTransparent()
 {
   canvas.fill(Qt::transparent);
@@ -262,10 +274,17 @@ bool Layer::save(QString filename)
   if(canvas.isNull())
     return false;
 
-  if(canvas.save(filename)) {
-    return true;
+  // The file may be a hardlink to cached media from an earlier run. Writing to it directly would
+  // overwrite the cached original as well, so the file is replaced instead of written through
+  QSaveFile outputFile(filename);
+  if(!outputFile.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+  if(!canvas.save(&outputFile, "PNG")) {
+    outputFile.cancelWriting();
+    return false;
   }
-  return false;
+  return outputFile.commit();
 }
 
 void Layer::colorFromHex(QString color)
@@ -45,6 +45,10 @@ constexpr int T_SATURATION = 15;
 constexpr int T_COLORIZE = 16;
 constexpr int T_ROTATE = 17;
 constexpr int T_SCANLINES = 18;
+// Only used in compiled render plans
+constexpr int T_COLORS = 19; // Adjacent color effects folded into one pass
+constexpr int T_DRAW = 20; // Composite the topmost layer onto the one below it
+constexpr int T_TYPES = 21;
 
 #include <QImage>
 #include <QPainter>
@@ -73,6 +77,7 @@ public:
   int blue = -1;
   int distance = -1;
   int softness = -1;
+  bool gaussian = false;
   int opacity = -1;
   QPainter::CompositionMode mode = QPainter::CompositionMode_SourceOver;
   Qt::Axis axis = Qt::ZAxis;
@@ -100,10 +105,12 @@ public:
   void setBlue(const int &blue);
   void setDistance(const int &distance);
   void setSoftness(const int &softness);
+  void setGaussian(const QString &type);
   void setOpacity(const int &opacity);
 
   void addLayer(const Layer &layer);
   QList<Layer> getLayers();
+  void clearLayers();
 
   void makeTransparent();
   void scale();
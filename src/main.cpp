@@ -106,12 +106,12 @@ BOOL WINAPI ConsoleHandler(DWORD dwType)
 	} else if(x->state == 1) {
 	  // Ignore signal, something important is going on that needs to finish!
 	} else if(x->state == 2) {
-	  // Cache being edited, clear the queue to quit nicely
-	  x->queue->clearAll();
+	  // Cache being edited, cancel the queue to quit nicely
+	  x->queue->cancel();
 	} else if(x->state == 3) {
-	  // Threads are running, clear queue for a nice exit
+	  // Threads are running, cancel the queue for a nice exit
 	  printf("\033[1;33mUser wants to quit, trying to exit nicely. This can take a few seconds depending on how many threads are running...\033[0m\n");
-	  x->queue->clearAll();
+	  x->queue->cancel();
 	}
       } else {
 	exit(1);
@@ -36,10 +36,7 @@ MobyGames::MobyGames(Settings *config,
 		     QSharedPointer<NetManager> manager)
   : AbstractScraper(config, manager)
 {
-  connect(&limitTimer, &QTimer::timeout, &limiter, &QEventLoop::quit);
-  limitTimer.setInterval(10000); // 10 second request limit
-  limitTimer.setSingleShot(false);
-  limitTimer.start();
+  manager->setRateLimit("api.mobygames.com", getRequestRate(0.1)); // 10 second request limit
 
   baseUrl = "https://api.mobygames.com";
 
@@ -63,7 +60,6 @@ void MobyGames::getSearchResults(QList<GameEntry> &gameEntries,
   QString platformId = getPlatformId(config->platform);
 
   printf("Waiting as advised by MobyGames api restrictions...\n");
-  limiter.exec();
   netComm->request(searchUrlPre + "?api_key=" + StrTools::unMagic("175;229;170;189;188;202;211;117;164;165;185;209;164;234;180;155;199;209;224;231;193;190;173;175") + "&title=" + searchName + (platformId == "na"?"":"&platform=" + platformId));
   q.exec();
   data = netComm->getData();
@@ -106,7 +102,6 @@ void MobyGames::getSearchResults(QList<GameEntry> &gameEntries,
 void MobyGames::getGameData(GameEntry &game)
 {
   printf("Waiting to get game data...\n");
-  limiter.exec();
   netComm->request(game.url);
   q.exec();
   data = netComm->getData();
@@ -158,6 +153,7 @@ void MobyGames::getGameData(GameEntry &game)
       ;
     }
   }
+  fetchMedia(game);
 }
 
 void MobyGames::getReleaseDate(GameEntry &game)
@@ -293,7 +289,6 @@ void MobyGames::getRating(GameEntry &game)
 void MobyGames::getCover(GameEntry &game)
 {
   printf("Waiting to get cover data...\n");
-  limiter.exec();
   netComm->request(game.url.left(game.url.indexOf("?api_key=")) + "/covers" + game.url.mid(game.url.indexOf("?api_key="), game.url.length() - game.url.indexOf("?api_key=")));
   q.exec();
   data = netComm->getData();
@@ -345,20 +340,13 @@ void MobyGames::getCover(GameEntry &game)
   coverUrl.replace("http://", "https://"); // For some reason the links are http but they are always redirected to https
 
   if(!coverUrl.isEmpty()) {
-    netComm->request(coverUrl);
-    q.exec();
-    QImage image;
-    if(netComm->getError() == QNetworkReply::NoError &&
-       image.loadFromData(netComm->getData())) {
-      game.coverData = netComm->getData();
-    }
+    addMediaRequest(COVER, coverUrl);
   }
 }
 
 void MobyGames::getScreenshot(GameEntry &game)
 {
   printf("Waiting to get screenshot data...\n");
-  limiter.exec();
   netComm->request(game.url.left(game.url.indexOf("?api_key=")) + "/screenshots" + game.url.mid(game.url.indexOf("?api_key="), game.url.length() - game.url.indexOf("?api_key=")));
   q.exec();
   data = netComm->getData();
@@ -382,13 +370,7 @@ void MobyGames::getScreenshot(GameEntry &game)
     chosen = (qrand() % jsonScreenshots.count() - 3) + 3;
 #endif
   }
-  netComm->request(jsonScreenshots.at(chosen).toObject()["image"].toString().replace("http://", "https://"));
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.screenshotData = netComm->getData();
-  }
+  addMediaRequest(SCREENSHOT, jsonScreenshots.at(chosen).toObject()["image"].toString().replace("http://", "https://"));
 }
 
 QString MobyGames::getPlatformId(const QString platform)
@@ -39,8 +39,6 @@ public:
   MobyGames(Settings *config, QSharedPointer<NetManager> manager);
 
 private:
-  QTimer limitTimer;
-  QEventLoop limiter;
   void getSearchResults(QList<GameEntry> &gameEntries,
 			QString searchName, QString platform) override;
   void getGameData(GameEntry &game) override;
@@ -25,6 +25,7 @@
 
 #include "nametools.h"
 #include "strtools.h"
+#include "digest.h"
 
 #include <QFileInfo>
 #include <QDir>
@@ -491,44 +492,45 @@ QString NameTools::getUniqueNotes(const QString &notes, QChar delim)
   return uniqueNotes;
 }
 
-QString NameTools::getCacheId(const QFileInfo &info)
+bool NameTools::isCacheIdFromData(const QFileInfo &info)
 {
-  QCryptographicHash cacheId(QCryptographicHash::Sha1);
-
   // Use checksum of filename if file is a script or an "unstable" compressed filetype
-  bool cacheIdFromData = true;
   if(info.suffix() == "uae" || info.suffix() == "cue" ||
      info.suffix() == "sh" || info.suffix() == "svm" ||
      info.suffix() == "scummvm" || info.suffix() == "mds" ||
      info.suffix() == "zip" || info.suffix() == "7z" ||
      info.suffix() == "gdi" || info.suffix() == "ml" ||
      info.suffix() == "bat" || info.suffix() == "au3") {
-    cacheIdFromData = false;
+    return false;
   }
   // If file is larger than 50 MBs, use filename checksum for cache id for optimization reasons
   if(info.size() > 52428800) {
-    cacheIdFromData = false;
+    return false;
   }
   // If file is empty always do checksum on filename
   if(info.size() == 0) {
-    cacheIdFromData = false;
+    return false;
   }
-  if(cacheIdFromData) {
-    QFile romFile(info.absoluteFilePath());
-    if(romFile.open(QIODevice::ReadOnly)) {
-      while(!romFile.atEnd()) {
-	cacheId.addData(romFile.read(1024));
-      }
-      romFile.close();
-    } else {
+  return true;
+}
+
+// With 'allDigests' the CRC32 and MD5 are calculated in the same pass and remembered for
+// the scraping modules that identify roms by checksums
+QString NameTools::getCacheId(const QFileInfo &info, const bool allDigests)
+{
+  if(isCacheIdFromData(info)) {
+    Digest digest(allDigests);
+    if(!digest.addFile(info.absoluteFilePath())) {
       printf("Couldn't calculate cache id of rom file '%s', please check permissions and try again, now exiting...\n", info.fileName().toStdString().c_str());
       exit(1);
     }
-  } else {
-    cacheId.addData(info.fileName().toUtf8());
+    if(allDigests) {
+      Digest::remember(info, digest);
+    }
+    return digest.sha1();
   }
 
-  return cacheId.result().toHex();
+  return QCryptographicHash::hash(info.fileName().toUtf8(), QCryptographicHash::Sha1).toHex();
 }
 
 QString NameTools::getNameFromTemplate(const GameEntry &game, const QString &nameTemplate)
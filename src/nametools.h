@@ -47,7 +47,8 @@ public:
   static QString getSqrNotes(QString baseName);
   static QString getParNotes(QString baseName);
   static QString getUniqueNotes(const QString &notes, QChar delim);
-  static QString getCacheId(const QFileInfo &info);
+  static bool isCacheIdFromData(const QFileInfo &info);
+  static QString getCacheId(const QFileInfo &info, const bool allDigests = false);
   static QString getNameFromTemplate(const GameEntry &game, const QString &nameTemplate);
 };
 
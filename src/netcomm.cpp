@@ -24,9 +24,13 @@
  */
 
 #include "netcomm.h"
+#include "fixturestore.h"
 
 #include <QUrl>
 #include <QNetworkRequest>
+#include <QDateTime>
+#include <QLocale>
+#include <QSet>
 
 constexpr int MAXSIZE = 100*1024*1024;
 
@@ -34,15 +38,18 @@ NetComm::NetComm(QSharedPointer<NetManager> manager)
   : manager(manager)
 {
   requestTimer.setSingleShot(true);
-  requestTimer.setInterval(30000);
   connect(&requestTimer, &QTimer::timeout, this, &NetComm::requestTimeout);
 }
 
-void NetComm::request(QString query, QString postData, QList<QPair<QString, QString> > headers)
+QNetworkRequest NetComm::createRequest(const QUrl &url, const QList<QPair<QString, QString> > &headers)
 {
-  QUrl url(query);
   QNetworkRequest request(url);
-  request.setHeader(QNetworkRequest::UserAgentHeader, "Mozilla/5.0 (X11; Ubuntu; Linux x86_64; rv:74.0) Gecko/20100101 Firefox/74.0");
+  request.setHeader(QNetworkRequest::UserAgentHeader, manager->userAgent);
+  // Qt negotiates 'Accept-Encoding: gzip, deflate' and decompresses replies by itself as long as
+  // the header isn't set here. HTTP/2 is only used if the server offers it during the handshake
+#if QT_VERSION >= 0x050800
+  request.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, manager->http2);
+#endif
   request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
 
   if(!headers.isEmpty()) {
@@ -50,26 +57,431 @@ void NetComm::request(QString query, QString postData, QList<QPair<QString, QStr
       request.setRawHeader(header.first.toUtf8(), header.second.toUtf8());
     }
   }
+  return request;
+}
+
+// Wait for our turn if the service is rate limited. The limit is shared by all threads. Returns
+// false if the turn comes after the deadline of the request
+bool NetComm::waitForTurn(const QString &host, const qint64 &requestDeadline)
+{
+  // Replays run as fast as possible
+  if(manager->replay) {
+    return true;
+  }
+  qint64 wait = manager->reserveRequest(host);
+  if(wait > 0) {
+    if(QDateTime::currentMSecsSinceEpoch() + wait > requestDeadline) {
+      return false;
+    }
+    QEventLoop limiter;
+    QTimer::singleShot((int)wait, &limiter, &QEventLoop::quit);
+    limiter.exec();
+  }
+  return true;
+}
+
+// Everything that can make the answer differ is part of the key
+QString NetComm::getRequestKey(const QString &query, const QString &postData,
+			       const QList<QPair<QString, QString> > &headers)
+{
+  QString key = (postData.isNull()?"GET ":"POST ") + query;
+  for(const auto &header: headers) {
+    key.append("\n" + header.first + ": " + header.second);
+  }
+  if(!postData.isNull()) {
+    key.append("\n\n" + postData);
+  }
+  return key;
+}
+
+void NetComm::request(QString query, QString postData, QList<QPair<QString, QString> > headers)
+{
+  BatchRequest result;
+  flightKey = getRequestKey(query, postData, headers);
+  if(manager->offline) {
+    replayCached(QUrl(query), postData.isNull(), result);
+    finishRequest(result);
+    return;
+  }
+
+  int flightState = manager->joinFlight(flightKey, result, flight);
+  if(flightState == FLIGHTWAIT) {
+    manager->waitFlight(flight, result);
+  }
+  if(flightState == FLIGHTWAIT || flightState == FLIGHTDONE) {
+    finishRequest(result);
+    return;
+  }
+
+  pendingQuery = query;
+  pendingPostData = postData;
+  pendingHeaders = headers;
+  attempt = 0;
+  deadline = QDateTime::currentMSecsSinceEpoch() + manager->deadline;
+  sendRequest();
+}
+
+void NetComm::sendRequest()
+{
+  QUrl url(pendingQuery);
+  QNetworkRequest request = createRequest(url, pendingHeaders);
+
+  if(!waitForTurn(url.host(), deadline)) {
+    BatchRequest result;
+    result.error = QNetworkReply::TimeoutError;
+    finishRequest(result);
+    return;
+  }
+
+  if(manager->replay) {
+    BatchRequest result;
+    manager->replayRequest(flightKey, url.host(), result);
+    handleResult(result);
+    return;
+  }
+
+  hasCached = pendingPostData.isNull() && addValidators(url, request, cachedEntry);
+  timedOut = false;
 
-  if(postData.isNull()) {
+  if(pendingPostData.isNull()) {
     reply = manager->getRequest(request);
   } else {
-    reply = manager->postRequest(request, postData.toUtf8());
+    reply = manager->postRequest(request, pendingPostData.toUtf8());
   }
   connect(reply, &QNetworkReply::finished, this, &NetComm::replyReady);
   connect(reply, &QNetworkReply::downloadProgress, this, &NetComm::dataDownloaded);
-  requestTimer.start();
+  requestTimer.start(manager->timeout);
 }
 
 void NetComm::replyReady()
 {
   requestTimer.stop();
-  data = reply->readAll();
-  error = reply->error();
-  contentType = reply->rawHeader("Content-Type");;
-  redirUrl = reply->rawHeader("Location");
+  BatchRequest result;
+  readReply(reply, result, (hasCached?&cachedEntry:nullptr), nullptr, timedOut);
   reply->deleteLater();
-  emit dataReady();
+  handleResult(result);
+}
+
+// Sends the request again if it failed with a transient error and there's time left to do so
+void NetComm::handleResult(const BatchRequest &result)
+{
+  if(attempt < manager->retries && manager->isTransient(result.error, result.status)) {
+    qint64 delay = manager->getBackoff(attempt);
+    if(QDateTime::currentMSecsSinceEpoch() + delay < deadline) {
+      attempt++;
+      printf("\033[1;33mRetrying request in %.1f seconds...\033[0m\n", delay / 1000.0);
+      QTimer::singleShot((int)delay, this, &NetComm::sendRequest);
+      return;
+    }
+  }
+  finishRequest(result);
+}
+
+void NetComm::finishRequest(const BatchRequest &result)
+{
+  if(!flight.isNull()) {
+    manager->finishFlight(flightKey, flight, result);
+  }
+  if(!manager->fixtures.isNull() && !manager->replay) {
+    manager->fixtures->save(flightKey, result);
+  }
+  data = result.data;
+  error = result.error;
+  contentType = result.contentType;
+  redirUrl = result.redirUrl;
+  // Callers wait for the signal after request() returns, so it's never emitted right away
+  QTimer::singleShot(0, this, &NetComm::dataReady);
+}
+
+// Runs all GET requests at once and returns when every one of them has finished or failed.
+// Requests that fail with a transient error are retried together with backoff until they
+// succeed, run out of retries or pass the deadline
+void NetComm::requestBatch(QList<BatchRequest> &requests)
+{
+  if(requests.isEmpty()) {
+    return;
+  }
+  if(manager->offline) {
+    for(auto &batchRequest: requests) {
+      // Replayed replies are already in memory
+      batchRequest.fileName.clear();
+      replayCached(QUrl(batchRequest.url), true, batchRequest);
+    }
+    return;
+  }
+  QList<int> pending;
+  QMap<int, QSharedPointer<Flight> > leading;
+  QMap<int, QSharedPointer<Flight> > following;
+  for(int a = 0; a < requests.length(); ++a) {
+    // Streamed replies end up in a file of their own, so they can't be shared
+    if(requests.at(a).fileName.isEmpty()) {
+      QSharedPointer<Flight> batchFlight;
+      int flightState = manager->joinFlight(getRequestKey(requests.at(a).url), requests[a], batchFlight);
+      if(flightState == FLIGHTDONE) {
+	continue;
+      } else if(flightState == FLIGHTWAIT) {
+	following.insert(a, batchFlight);
+	continue;
+      } else if(flightState == FLIGHTLEAD) {
+	leading.insert(a, batchFlight);
+      }
+    }
+    pending.append(a);
+  }
+  sendPending(requests, pending);
+  // Other threads may be waiting for ours, so hand them over before waiting for theirs
+  for(auto it = leading.begin(); it != leading.end(); ++it) {
+    manager->finishFlight(getRequestKey(requests.at(it.key()).url), it.value(), requests.at(it.key()));
+  }
+  for(auto it = following.begin(); it != following.end(); ++it) {
+    manager->waitFlight(it.value(), requests[it.key()]);
+  }
+  if(!manager->fixtures.isNull()) {
+    for(const auto &batchRequest: requests) {
+      manager->fixtures->save(getRequestKey(batchRequest.url), batchRequest);
+    }
+  }
+}
+
+void NetComm::sendPending(QList<BatchRequest> &requests, QList<int> pending)
+{
+  if(pending.isEmpty()) {
+    return;
+  }
+  qint64 batchDeadline = QDateTime::currentMSecsSinceEpoch() + manager->deadline;
+  for(int batchAttempt = 0; ; ++batchAttempt) {
+    sendBatch(requests, pending, batchDeadline);
+    QList<int> failed;
+    for(const auto a: pending) {
+      if(manager->isTransient(requests.at(a).error, requests.at(a).status)) {
+	failed.append(a);
+      }
+    }
+    if(failed.isEmpty() || batchAttempt >= manager->retries) {
+      break;
+    }
+    qint64 delay = manager->getBackoff(batchAttempt);
+    if(QDateTime::currentMSecsSinceEpoch() + delay >= batchDeadline) {
+      break;
+    }
+    printf("\033[1;33mRetrying %d request(s) in %.1f seconds...\033[0m\n", failed.length(), delay / 1000.0);
+    QEventLoop backoffLoop;
+    QTimer::singleShot((int)delay, &backoffLoop, &QEventLoop::quit);
+    backoffLoop.exec();
+    pending = failed;
+  }
+}
+
+// Sends the requests at the given indexes at once. Rate limits still apply, so requests to a
+// limited host are sent as their turns come up
+void NetComm::sendBatch(QList<BatchRequest> &requests, const QList<int> &indexes, const qint64 &batchDeadline)
+{
+  QEventLoop batchLoop;
+  int unfinished = indexes.length();
+  QList<QNetworkReply *> replies;
+  QList<HttpCacheEntry> cachedEntries;
+  QList<bool> cached;
+  QList<QSaveFile *> saveFiles;
+  QSet<QNetworkReply *> timedOutReplies;
+  for(const auto a: indexes) {
+    BatchRequest &batchRequest = requests[a];
+    QUrl url(batchRequest.url);
+    QNetworkRequest request = createRequest(url);
+    cachedEntries.append(HttpCacheEntry());
+    bool inTime = waitForTurn(url.host(), batchDeadline);
+    if(!inTime || manager->replay) {
+      if(inTime) {
+	// Replayed replies are already in memory
+	batchRequest.fileName.clear();
+	manager->replayRequest(getRequestKey(batchRequest.url), url.host(), batchRequest);
+      } else {
+	batchRequest.data.clear();
+	batchRequest.error = QNetworkReply::TimeoutError;
+	batchRequest.status = 0;
+      }
+      replies.append(nullptr);
+      cached.append(false);
+      saveFiles.append(nullptr);
+      unfinished--;
+      continue;
+    }
+    QSaveFile *saveFile = nullptr;
+    if(!batchRequest.fileName.isEmpty()) {
+      // QSaveFile writes to a temporary file next to the target and only renames it into place
+      // on commit, so a failed or aborted download never leaves a partial file behind
+      saveFile = new QSaveFile(batchRequest.fileName);
+      if(!saveFile->open(QIODevice::WriteOnly)) {
+	delete saveFile;
+	saveFile = nullptr;
+	batchRequest.fileName.clear();
+      }
+    }
+    saveFiles.append(saveFile);
+    // Streamed replies are usually videos, which are too large for the http cache anyway
+    cached.append(saveFile == nullptr && addValidators(url, request, cachedEntries.last()));
+    QNetworkReply *batchReply = manager->getRequest(request);
+    if(saveFile != nullptr) {
+      connect(batchReply, &QNetworkReply::readyRead, saveFile, [batchReply, saveFile]() {
+	  saveFile->write(batchReply->readAll());
+	});
+    }
+    connect(batchReply, &QNetworkReply::finished, &batchLoop, [&unfinished, &batchLoop]() {
+	if(--unfinished == 0) {
+	  batchLoop.quit();
+	}
+      });
+    // The timeout is for inactivity and starts over whenever data arrives. A large video on a
+    // slow connection takes as long as it takes, and only a reply that stalls is aborted and
+    // retried. The replies share the bandwidth, so a timeout for the batch as a whole would
+    // abort downloads that are still making progress
+    QTimer *idleTimer = new QTimer(batchReply);
+    idleTimer->setSingleShot(true);
+    idleTimer->setInterval(manager->timeout);
+    connect(idleTimer, &QTimer::timeout, batchReply, [batchReply, &timedOutReplies]() {
+	printf("\033[1;33mRequest timed out, server might be busy / overloaded...\033[0m\n");
+	timedOutReplies.insert(batchReply);
+	batchReply->abort();
+      });
+    connect(batchReply, &QNetworkReply::finished, idleTimer, &QTimer::stop);
+    connect(batchReply, &QNetworkReply::downloadProgress, batchReply, [batchReply, idleTimer](qint64 bytesReceived, qint64) {
+	idleTimer->start();
+	if(bytesReceived > MAXSIZE) {
+	  printf("Retrieved data size exceeded maximum of 100 MB, cancelling network request...\n");
+	  batchReply->abort();
+	}
+      });
+    idleTimer->start();
+    replies.append(batchReply);
+  }
+
+  // Replies may already have finished while waiting for a rate limited turn
+  if(unfinished > 0) {
+    batchLoop.exec();
+  }
+
+  for(int a = 0; a < replies.length(); ++a) {
+    QNetworkReply *batchReply = replies.at(a);
+    if(batchReply == nullptr) {
+      continue;
+    }
+    readReply(batchReply, requests[indexes.at(a)], (cached.at(a)?&cachedEntries.at(a):nullptr),
+	      saveFiles.at(a), timedOutReplies.contains(batchReply));
+    batchReply->deleteLater();
+  }
+  qDeleteAll(saveFiles);
+}
+
+// Adds the validators of a cached reply to the request, so the server can answer with a
+// '304 Not Modified' instead of sending the same data again
+bool NetComm::addValidators(const QUrl &url, QNetworkRequest &request, HttpCacheEntry &cachedEntry)
+{
+  if(manager->httpCache.isNull() || !manager->httpCache->lookup(url, cachedEntry)) {
+    return false;
+  }
+  if(!cachedEntry.eTag.isEmpty()) {
+    request.setRawHeader("If-None-Match", cachedEntry.eTag);
+  }
+  if(!cachedEntry.lastModified.isEmpty()) {
+    request.setRawHeader("If-Modified-Since", cachedEntry.lastModified);
+  }
+  return true;
+}
+
+// Offline mode only ever answers from the http cache
+void NetComm::replayCached(const QUrl &url, const bool &isGet, BatchRequest &result)
+{
+  HttpCacheEntry cachedEntry;
+  if(isGet && !manager->httpCache.isNull() && manager->httpCache->lookup(url, cachedEntry)) {
+    result.data = cachedEntry.data;
+    result.contentType = cachedEntry.contentType;
+    result.error = QNetworkReply::NoError;
+  } else {
+    result.data.clear();
+    result.contentType.clear();
+    result.error = QNetworkReply::ContentNotFoundError;
+  }
+  result.size = result.data.size();
+}
+
+void NetComm::readReply(QNetworkReply *netReply, BatchRequest &result, const HttpCacheEntry *cachedEntry,
+			QSaveFile *saveFile, const bool &timedOut)
+{
+  checkRateLimit(netReply);
+  int status = netReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  result.status = status;
+  result.error = netReply->error();
+  result.redirUrl = netReply->rawHeader("Location");
+  if(timedOut) {
+    // Aborted by our own timer, not because the reply was too large
+    result.error = QNetworkReply::TimeoutError;
+  }
+  manager->reportResult(netReply->request().url().host(), manager->isTransient(result.error, status));
+  if(status == 304 && cachedEntry != nullptr) {
+    result.data = cachedEntry->data;
+    result.contentType = cachedEntry->contentType;
+    result.error = QNetworkReply::NoError;
+    result.size = result.data.size();
+    return;
+  }
+  result.contentType = netReply->rawHeader("Content-Type");
+  if(saveFile != nullptr) {
+    // Write whatever arrived after the last readyRead
+    saveFile->write(netReply->readAll());
+    result.size = saveFile->size();
+    if(result.error != QNetworkReply::NoError) {
+      saveFile->cancelWriting();
+    }
+    if(!saveFile->commit() && result.error == QNetworkReply::NoError) {
+      result.error = QNetworkReply::UnknownContentError;
+    }
+    return;
+  }
+  result.data = netReply->readAll();
+  result.size = result.data.size();
+  // Keep complete GET replies for revalidation and offline mode
+  if(status == 200 && result.error == QNetworkReply::NoError &&
+     netReply->operation() == QNetworkAccessManager::GetOperation &&
+     !manager->httpCache.isNull()) {
+    HttpCacheEntry newEntry;
+    newEntry.eTag = netReply->rawHeader("ETag");
+    newEntry.lastModified = netReply->rawHeader("Last-Modified");
+    newEntry.contentType = result.contentType;
+    newEntry.data = result.data;
+    manager->httpCache->store(netReply->request().url(), newEntry);
+  }
+}
+
+// Makes all threads back off from the host if the server asks us to
+void NetComm::checkRateLimit(QNetworkReply *limitReply)
+{
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+  qint64 until = 0;
+  if(limitReply->hasRawHeader("Retry-After")) {
+    // Either a number of seconds or a http date
+    QByteArray retryAfter = limitReply->rawHeader("Retry-After").trimmed();
+    bool isNumber = false;
+    qint64 seconds = retryAfter.toLongLong(&isNumber);
+    if(isNumber) {
+      until = now + seconds * 1000;
+    } else {
+      QDateTime date = QLocale::c().toDateTime(QString(retryAfter), "ddd, dd MMM yyyy hh:mm:ss 'GMT'");
+      if(date.isValid()) {
+	date.setTimeSpec(Qt::UTC);
+	until = date.toMSecsSinceEpoch();
+      }
+    }
+  } else if(limitReply->rawHeader("X-RateLimit-Remaining").trimmed() == "0" &&
+	    limitReply->hasRawHeader("X-RateLimit-Reset")) {
+    // Some services send seconds until the reset, others an epoch timestamp
+    qint64 reset = limitReply->rawHeader("X-RateLimit-Reset").trimmed().toLongLong();
+    until = (reset > 1000000000 ? reset * 1000 : now + reset * 1000);
+  }
+  if(until > now) {
+    if(until - now >= 5000) {
+      printf("\033[1;33mServer asked us to wait %lld seconds before the next request, waiting...\033[0m\n", (until - now) / 1000);
+    }
+    manager->holdRequests(limitReply->url().host(), until);
+  }
 }
 
 QByteArray NetComm::getData()
@@ -78,6 +490,12 @@ QByteArray NetComm::getData()
 }
 
 QNetworkReply::NetworkError NetComm::getError(const int &verbosity)
+{
+  printError(error, verbosity);
+  return error;
+}
+
+void NetComm::printError(const QNetworkReply::NetworkError &error, const int &verbosity)
 {
   if(error != QNetworkReply::NoError && verbosity >= 1) {
     switch(error) {
@@ -120,7 +538,6 @@ QNetworkReply::NetworkError NetComm::getError(const int &verbosity)
       break;
     }
   }
-  return error;
 }
 
 QByteArray NetComm::getContentType()
@@ -133,8 +550,27 @@ QByteArray NetComm::getRedirUrl()
   return redirUrl;
 }
 
+// Call when the reply of the last request() didn't pass validation, so asking again reaches
+// the network instead of getting the same reply from the memo
+void NetComm::forgetReply()
+{
+  if(!flightKey.isEmpty()) {
+    manager->forgetFlight(flightKey);
+  }
+}
+
+// For modules that retry on answers that are valid http but still tell us to try again later
+void NetComm::waitBackoff(const int &attempt)
+{
+  QEventLoop backoffLoop;
+  QTimer::singleShot((int)manager->getBackoff(attempt), &backoffLoop, &QEventLoop::quit);
+  backoffLoop.exec();
+}
+
 void NetComm::dataDownloaded(qint64 bytesReceived, qint64)
 {
+  // Only time out when the reply stalls, not while data is still arriving
+  requestTimer.start();
   if(bytesReceived > MAXSIZE) {
     printf("Retrieved data size exceeded maximum of 100 MB, cancelling network request...\n");
     reply->abort();
@@ -144,5 +580,6 @@ void NetComm::dataDownloaded(qint64 bytesReceived, qint64)
 void NetComm::requestTimeout()
 { 
   printf("\033[1;33mRequest timed out, server might be busy / overloaded...\033[0m\n");
+  timedOut = true;
   reply->abort();
 }
@@ -30,6 +30,8 @@
 
 #include <QNetworkReply>
 #include <QTimer>
+#include <QEventLoop>
+#include <QSaveFile>
 
 class NetComm : public QObject
 {
@@ -38,12 +40,17 @@ class NetComm : public QObject
 public:
   NetComm(QSharedPointer<NetManager> manager);
   void request(QString query, QString postData = QString(), QList<QPair<QString, QString> > headers = QList<QPair<QString, QString> >());
+  void requestBatch(QList<BatchRequest> &requests);
   QByteArray getData();
   QNetworkReply::NetworkError getError(const int &verbosity = 0);
+  static void printError(const QNetworkReply::NetworkError &error, const int &verbosity);
   QByteArray getContentType();
   QByteArray getRedirUrl();
+  void forgetReply();
+  void waitBackoff(const int &attempt);
 
 private slots:
+  void sendRequest();
   void replyReady();
   void dataDownloaded(qint64 bytesReceived, qint64);
   void requestTimeout();
@@ -59,6 +66,31 @@ private:
   QByteArray contentType;
   QByteArray redirUrl;
   QNetworkReply *reply;
+  // The current request, kept so it can be sent again if it fails
+  QString pendingQuery;
+  QString pendingPostData;
+  QList<QPair<QString, QString> > pendingHeaders;
+  int attempt = 0;
+  qint64 deadline = 0;
+  bool timedOut = false;
+  QString flightKey;
+  QSharedPointer<Flight> flight;
+
+  QNetworkRequest createRequest(const QUrl &url, const QList<QPair<QString, QString> > &headers = QList<QPair<QString, QString> >());
+  bool waitForTurn(const QString &host, const qint64 &requestDeadline);
+  static QString getRequestKey(const QString &query, const QString &postData = QString(),
+			       const QList<QPair<QString, QString> > &headers = QList<QPair<QString, QString> >());
+  void handleResult(const BatchRequest &result);
+  void finishRequest(const BatchRequest &result);
+  void sendPending(QList<BatchRequest> &requests, QList<int> pending);
+  void sendBatch(QList<BatchRequest> &requests, const QList<int> &indexes, const qint64 &batchDeadline);
+  void checkRateLimit(QNetworkReply *limitReply);
+  bool addValidators(const QUrl &url, QNetworkRequest &request, HttpCacheEntry &cachedEntry);
+  void replayCached(const QUrl &url, const bool &isGet, BatchRequest &result);
+  void readReply(QNetworkReply *netReply, BatchRequest &result, const HttpCacheEntry *cachedEntry,
+		 QSaveFile *saveFile, const bool &timedOut);
+  bool hasCached = false;
+  HttpCacheEntry cachedEntry;
 };
 
 #endif // NETCOMM_H
@@ -24,21 +24,311 @@
  */
 
 #include "netmanager.h"
+#include "fixturestore.h"
 
 #include <QNetworkRequest>
+#include <QDateTime>
+#if QT_VERSION >= 0x050a00
+#include <QRandomGenerator>
+#endif
+
+constexpr int BACKOFFBASE = 1000;
+constexpr int BACKOFFMAX = 30000;
+constexpr int BREAKERTHRESHOLD = 5;
+constexpr qint64 BREAKERCOOLDOWN = 10000;
+constexpr qint64 BREAKERCOOLDOWNMAX = 120000;
+constexpr int MEMOMAXSIZE = 64 * 1024 * 1024;
+constexpr qint64 MEMOMAXAGE = 600000;
+
+// Some of the sites scraped by the html based modules only answer browsers
+constexpr char DEFAULTUSERAGENT[] = "Mozilla/5.0 (X11; Ubuntu; Linux x86_64; rv:74.0) Gecko/20100101 Firefox/74.0";
 
 NetManager::NetManager()
+  : userAgent(DEFAULTUSERAGENT)
 {
+  flightMemos.setMaxCost(MEMOMAXSIZE);
 }
 
 QNetworkReply *NetManager::getRequest(const QNetworkRequest &request)
 {
   QMutexLocker locker(&requestMutex);
-  return get(request);
+  QNetworkReply *reply = get(request);
+  countReply(reply);
+  return reply;
 }
 
 QNetworkReply *NetManager::postRequest(const QNetworkRequest &request, const QByteArray &data)
 {
   QMutexLocker locker(&requestMutex);
-  return post(request, data);
+  QNetworkReply *reply = post(request, data);
+  countReply(reply);
+  return reply;
+}
+
+// All threads share this manager, so they also share its pool of keep-alive connections per host.
+// A TLS handshake only happens when a new connection is opened, which makes it a good measure of
+// how well connections are reused. Direct connections since the replies live in the worker threads
+void NetManager::countReply(QNetworkReply *reply)
+{
+  requests.fetchAndAddRelaxed(1);
+#ifndef QT_NO_SSL
+  connect(reply, &QNetworkReply::encrypted, [this]() {
+      handshakes.fetchAndAddRelaxed(1);
+    });
+#endif
+#if QT_VERSION >= 0x050900
+  connect(reply, &QNetworkReply::finished, [this, reply]() {
+      if(reply->attribute(QNetworkRequest::HTTP2WasUsedAttribute).toBool()) {
+	http2Replies.fetchAndAddRelaxed(1);
+      }
+    });
+#endif
+}
+
+void NetManager::setTransport(const bool &http2, const QString &userAgent)
+{
+  this->http2 = http2;
+  if(!userAgent.isEmpty()) {
+    this->userAgent = userAgent;
+  }
+}
+
+// Sets a token bucket limit shared by all threads for a domain and its subdomains.
+// Every worker constructs its own scraper, so setting the same limit again is a no-op
+void NetManager::setRateLimit(const QString &domain, const double &perSecond, const int &burst)
+{
+  QMutexLocker locker(&limitMutex);
+  RateLimit &limit = rateLimits[domain];
+  if(limit.perSecond == perSecond && limit.burst == burst) {
+    return;
+  }
+  limit.perSecond = perSecond;
+  limit.burst = qMax(burst, 1);
+  limit.tokens = limit.burst;
+  limit.updated = QDateTime::currentMSecsSinceEpoch();
+}
+
+QMap<QString, RateLimit>::iterator NetManager::findRateLimit(const QString &host)
+{
+  for(auto it = rateLimits.begin(); it != rateLimits.end(); ++it) {
+    if(host == it.key() || host.endsWith("." + it.key())) {
+      return it;
+    }
+  }
+  return rateLimits.end();
+}
+
+// Takes a token for a request to 'host' and returns how many milliseconds the caller has to
+// wait before sending it. Tokens are reserved even when none are left, so waiting threads
+// are served in the order they asked
+qint64 NetManager::reserveRequest(const QString &host)
+{
+  QMutexLocker locker(&limitMutex);
+  auto it = findRateLimit(host);
+  if(it == rateLimits.end()) {
+    return 0;
+  }
+  RateLimit &limit = it.value();
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+  qint64 wait = 0;
+  if(limit.perSecond > 0.0) {
+    limit.tokens = qMin(limit.burst, limit.tokens + (now - limit.updated) * limit.perSecond / 1000.0);
+    limit.updated = now;
+    limit.tokens -= 1.0;
+    if(limit.tokens < 0.0) {
+      wait = (qint64)(-limit.tokens * 1000.0 / limit.perSecond + 0.5);
+    }
+  }
+  if(limit.heldUntil > now + wait) {
+    wait = limit.heldUntil - now;
+  }
+  return wait;
+}
+
+// Used when a server tells us to back off through 'Retry-After' or 'X-RateLimit-*' headers
+void NetManager::holdRequests(const QString &host, const qint64 &until)
+{
+  QMutexLocker locker(&limitMutex);
+  auto it = findRateLimit(host);
+  if(it == rateLimits.end()) {
+    it = rateLimits.insert(host, RateLimit());
+  }
+  if(until > it.value().heldUntil) {
+    it.value().heldUntil = until;
+  }
+}
+
+void NetManager::setHttpCache(const QString &folder, const qint64 &maxSize, const bool &offline)
+{
+  if(maxSize > 0) {
+    httpCache = QSharedPointer<HttpCache>(new HttpCache(folder, maxSize));
+  }
+  this->offline = offline;
+}
+
+void NetManager::setFixtures(const QString &folder, const bool &record, const bool &replay)
+{
+  if(record || replay) {
+    fixtures = QSharedPointer<FixtureStore>(new FixtureStore(folder));
+  }
+  this->replay = replay;
+}
+
+// Stands in for the real service when replaying. Requests that weren't recorded fail as if the
+// data wasn't found
+void NetManager::replayRequest(const QString &key, const QString &host, BatchRequest &result)
+{
+  if(!fixtures->load(key, result)) {
+    result.data.clear();
+    result.status = 404;
+    result.error = QNetworkReply::ContentNotFoundError;
+  }
+  result.size = result.data.size();
+  reportResult(host, isTransient(result.error, result.status));
+}
+
+void NetManager::setRetryPolicy(const int &retries, const int &timeout)
+{
+  this->retries = qMax(retries, 0);
+  this->timeout = qMax(timeout, 1000);
+  // Leave room for every attempt to time out plus the backoff between them
+  deadline = qMax((qint64)this->timeout * (this->retries + 1) + BACKOFFMAX * this->retries, (qint64)300000);
+}
+
+// Errors that are likely to go away if the same request is sent again a bit later
+bool NetManager::isTransient(const QNetworkReply::NetworkError &error, const int &status)
+{
+  if(status == 429 || status == 502 || status == 503 || status == 504) {
+    return true;
+  }
+  switch(error) {
+  case QNetworkReply::TimeoutError:
+  case QNetworkReply::RemoteHostClosedError:
+  case QNetworkReply::ConnectionRefusedError:
+  case QNetworkReply::TemporaryNetworkFailureError:
+  case QNetworkReply::NetworkSessionFailedError:
+  case QNetworkReply::ProxyTimeoutError:
+  case QNetworkReply::InternalServerError:
+  case QNetworkReply::ServiceUnavailableError:
+  case QNetworkReply::UnknownServerError:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Exponential backoff with jitter, so threads that failed at the same time don't all retry at once
+qint64 NetManager::getBackoff(const int &attempt)
+{
+  qint64 delay = qMin((qint64)BACKOFFBASE << qMin(attempt, 10), (qint64)BACKOFFMAX);
+#if QT_VERSION >= 0x050a00
+  return delay / 2 + QRandomGenerator::global()->bounded(delay / 2 + 1);
+#else
+  return delay / 2 + qrand() % (delay / 2 + 1);
+#endif
+}
+
+// Counts transient failures in a row for a host. When too many requests fail, the service is
+// most likely down or overloaded, so all threads pause their requests to it for a while instead
+// of using up their retries. The pause grows every time it happens without a success in between
+void NetManager::reportResult(const QString &host, const bool &failed)
+{
+  qint64 cooldown = 0;
+  {
+    QMutexLocker locker(&breakerMutex);
+    CircuitBreaker &breaker = breakers[host];
+    if(!failed) {
+      breaker.failures = 0;
+      breaker.trips = 0;
+      return;
+    }
+    if(++breaker.failures < BREAKERTHRESHOLD) {
+      return;
+    }
+    cooldown = qMin(BREAKERCOOLDOWN << qMin(breaker.trips, 4), BREAKERCOOLDOWNMAX);
+    breaker.failures = 0;
+    breaker.trips++;
+  }
+  printf("\033[1;33mRequests to '%s' keep failing, the service might be down. Pausing all requests to it for %lld seconds...\033[0m\n", host.toStdString().c_str(), cooldown / 1000);
+  holdRequests(host, QDateTime::currentMSecsSinceEpoch() + cooldown);
+}
+
+// Copies the reply part of a request, leaving the url and file name of the receiver alone
+static void copyResult(const BatchRequest &from, BatchRequest &to)
+{
+  to.data = from.data;
+  to.contentType = from.contentType;
+  to.error = from.error;
+  to.size = from.size;
+  to.status = from.status;
+  to.redirUrl = from.redirUrl;
+}
+
+// Roms that resolve to the same game, like clones or the discs of a set, make the threads ask
+// for the same urls at the same time. Only the first thread sends the request and the others
+// wait for its result. Recent results are remembered for a while for those that come later.
+// Duplicates from the thread that is already sending the request are just sent again, since
+// waiting for ourselves would never end
+int NetManager::joinFlight(const QString &key, BatchRequest &result, QSharedPointer<Flight> &flight)
+{
+  QMutexLocker locker(&flightMutex);
+  FlightMemo *memo = flightMemos.object(key);
+  if(memo != nullptr) {
+    if(QDateTime::currentMSecsSinceEpoch() - memo->stored < MEMOMAXAGE) {
+      copyResult(memo->result, result);
+      return FLIGHTDONE;
+    }
+    flightMemos.remove(key);
+  }
+  auto it = flights.find(key);
+  if(it != flights.end()) {
+    if(it.value()->owner == QThread::currentThread()) {
+      return FLIGHTSEND;
+    }
+    flight = it.value();
+    return FLIGHTWAIT;
+  }
+  flight = QSharedPointer<Flight>(new Flight);
+  flight->owner = QThread::currentThread();
+  flights.insert(key, flight);
+  return FLIGHTLEAD;
+}
+
+void NetManager::finishFlight(const QString &key, QSharedPointer<Flight> &flight, const BatchRequest &result)
+{
+  QMutexLocker locker(&flightMutex);
+  copyResult(result, flight->result);
+  flight->done = true;
+  if(flights.value(key) == flight) {
+    flights.remove(key);
+  }
+  // Only remember answers that won't be different if asked again right away. An empty body is
+  // more likely a hiccup than an answer
+  if((result.error == QNetworkReply::NoError && !result.data.isEmpty()) ||
+     result.error == QNetworkReply::ContentNotFoundError) {
+    FlightMemo *memo = new FlightMemo;
+    copyResult(result, memo->result);
+    memo->stored = QDateTime::currentMSecsSinceEpoch();
+    flightMemos.insert(key, memo, result.data.size() + 1);
+  }
+  flight.clear();
+  flightDone.wakeAll();
+}
+
+void NetManager::waitFlight(QSharedPointer<Flight> &flight, BatchRequest &result)
+{
+  QMutexLocker locker(&flightMutex);
+  while(!flight->done) {
+    flightDone.wait(&flightMutex);
+  }
+  copyResult(flight->result, result);
+  flight.clear();
+}
+
+// For replies that came back without errors but that the caller found no use for, such as a
+// service telling us it is too busy. Those must not be handed to the next ones asking
+void NetManager::forgetFlight(const QString &key)
+{
+  QMutexLocker locker(&flightMutex);
+  flightMemos.remove(key);
 }
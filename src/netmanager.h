@@ -29,6 +29,65 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QMutex>
+#include <QMap>
+#include <QAtomicInt>
+#include <QWaitCondition>
+#include <QCache>
+#include <QThread>
+#include <QSharedPointer>
+
+#include "httpcache.h"
+
+class FixtureStore;
+
+struct RateLimit
+{
+  double perSecond = 0.0;
+  double burst = 1.0;
+  double tokens = 1.0;
+  qint64 updated = 0;
+  qint64 heldUntil = 0;
+};
+
+struct BatchRequest
+{
+  QString url;
+  QByteArray data;
+  QByteArray contentType;
+  QNetworkReply::NetworkError error = QNetworkReply::UnknownNetworkError;
+  // If set, the reply is streamed to this file instead of being kept in 'data'. It is cleared
+  // if the file couldn't be written, in which case the reply is kept in 'data' after all
+  QString fileName;
+  qint64 size = 0;
+  int status = 0;
+  QByteArray redirUrl;
+};
+
+// An identical request that is currently being sent by one of the threads
+struct Flight
+{
+  QThread *owner = nullptr;
+  bool done = false;
+  BatchRequest result;
+};
+
+struct FlightMemo
+{
+  BatchRequest result;
+  qint64 stored = 0;
+};
+
+// Return values of NetManager::joinFlight()
+constexpr int FLIGHTSEND = 0; // Send the request yourself
+constexpr int FLIGHTLEAD = 1; // Send the request and hand the result to the others with finishFlight()
+constexpr int FLIGHTWAIT = 2; // Another thread is sending it, get the result with waitFlight()
+constexpr int FLIGHTDONE = 3; // The result of a recent identical request was copied into 'result'
+
+struct CircuitBreaker
+{
+  int failures = 0;
+  int trips = 0;
+};
 
 class NetManager : public QNetworkAccessManager
 {
@@ -38,8 +97,46 @@ public:
   NetManager();
   QNetworkReply *getRequest(const QNetworkRequest &request);
   QNetworkReply *postRequest(const QNetworkRequest &request, const QByteArray &data);
+  void setRateLimit(const QString &domain, const double &perSecond, const int &burst = 1);
+  qint64 reserveRequest(const QString &host);
+  void holdRequests(const QString &host, const qint64 &until);
+  void setHttpCache(const QString &folder, const qint64 &maxSize, const bool &offline);
+  void setTransport(const bool &http2, const QString &userAgent);
+  void setFixtures(const QString &folder, const bool &record, const bool &replay);
+  void replayRequest(const QString &key, const QString &host, BatchRequest &result);
+  void setRetryPolicy(const int &retries, const int &timeout);
+  bool isTransient(const QNetworkReply::NetworkError &error, const int &status);
+  qint64 getBackoff(const int &attempt);
+  void reportResult(const QString &host, const bool &failed);
+  int joinFlight(const QString &key, BatchRequest &result, QSharedPointer<Flight> &flight);
+  void finishFlight(const QString &key, QSharedPointer<Flight> &flight, const BatchRequest &result);
+  void waitFlight(QSharedPointer<Flight> &flight, BatchRequest &result);
+  void forgetFlight(const QString &key);
+  QSharedPointer<HttpCache> httpCache;
+  bool offline = false;
+  QSharedPointer<FixtureStore> fixtures; // Only set when recording or replaying
+  bool replay = false;
+  bool http2 = true;
+  QString userAgent;
+  int retries = 3;
+  int timeout = 30000; // Per attempt, in ms
+  qint64 deadline = 300000; // For all attempts of a request including waits, in ms
+  // Transport statistics for the end of run stats
+  QAtomicInt requests;
+  QAtomicInt handshakes;
+  QAtomicInt http2Replies;
 
 private:
   QMutex requestMutex;
+  QMutex limitMutex;
+  QMap<QString, RateLimit> rateLimits;
+  QMutex breakerMutex;
+  QMap<QString, CircuitBreaker> breakers;
+  QMutex flightMutex;
+  QWaitCondition flightDone;
+  QMap<QString, QSharedPointer<Flight> > flights;
+  QCache<QString, FlightMemo> flightMemos;
+  QMap<QString, RateLimit>::iterator findRateLimit(const QString &host);
+  void countReply(QNetworkReply *reply);
 };
 #endif // NETMANAGER_H
@@ -206,6 +206,7 @@ void OpenRetro::getGameData(GameEntry &game)
       ;
     }
   }
+  fetchMedia(game);
 }
 
 void OpenRetro::getDescription(GameEntry &game)
@@ -259,7 +260,7 @@ void OpenRetro::getTags(GameEntry &game)
   game.tags = tags;
 }
 
-void OpenRetro::getCover(GameEntry &game)
+void OpenRetro::getCover(GameEntry &)
 {
   if(coverPre.isEmpty()) {
     return;
@@ -276,16 +277,10 @@ void OpenRetro::getCover(GameEntry &game)
   if(coverUrl.left(4) != "http") {
     coverUrl.prepend(baseUrl + (coverUrl.left(1) == "/"?"":"/"));
   }
-  netComm->request(coverUrl);
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.coverData = netComm->getData();
-  }
+  addMediaRequest(COVER, coverUrl);
 }
 
-void OpenRetro::getMarquee(GameEntry &game)
+void OpenRetro::getMarquee(GameEntry &)
 {
   if(marqueePre.isEmpty()) {
     return;
@@ -302,13 +297,7 @@ void OpenRetro::getMarquee(GameEntry &game)
   if(marqueeUrl.left(4) != "http") {
     marqueeUrl.prepend(baseUrl + (marqueeUrl.left(1) == "/"?"":"/"));
   }
-  netComm->request(marqueeUrl);
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.marqueeData = netComm->getData();
-  }
+  addMediaRequest(MARQUEE, marqueeUrl);
 }
 
 QList<QString> OpenRetro::getSearchNames(const QFileInfo &info)
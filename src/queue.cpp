@@ -26,41 +26,78 @@
 #include "queue.h"
 
 #include <QRegularExpression>
+#include <QSet>
 
 Queue::Queue()
 {
 }
 
-bool Queue::hasEntry()
+void Queue::distribute(const int &workers,
+		       const std::function<int(const QFileInfo &)> &getPriority)
 {
-  queueMutex.lock();
-  if(isEmpty()) {
-    queueMutex.unlock();
-    return false;
+  workerQueues.clear();
+  for(int a = 0; a < qMax(workers, 1); ++a) {
+    workerQueues.append(QSharedPointer<WorkerQueue>(new WorkerQueue));
   }
-  return true;
+  // Round robin keeps every worker's share in the original file order
+  int next = 0;
+  for(const auto &info: *this) {
+    int priority = PRIONEW;
+    if(getPriority) {
+      priority = qBound(0, getPriority(info), PRIORITIES - 1);
+    }
+    workerQueues.at(next)->entries[priority].append(info);
+    pending[priority].fetchAndAddRelaxed(1);
+    next = (next + 1) % workerQueues.length();
+  }
+  clear();
 }
 
-QFileInfo Queue::takeEntry()
+bool Queue::takeEntry(const int &worker, QFileInfo &info, const int &maxPriority)
 {
-  QFileInfo info = first();
-  removeFirst();
-  queueMutex.unlock();
-  return info;
+  for(int priority = 0; priority <= maxPriority; ++priority) {
+    // Skip empty priorities without touching any of the worker locks
+    while(pending[priority].loadAcquire() > 0) {
+      if(cancelled.loadAcquire()) {
+	return false;
+      }
+      // Take from the front of our own queue first, then steal from the back of the others
+      for(int a = 0; a < workerQueues.length(); ++a) {
+	const QSharedPointer<WorkerQueue> &workerQueue =
+	  workerQueues.at((worker + a) % workerQueues.length());
+	QMutexLocker locker(&workerQueue->mutex);
+	QList<QFileInfo> &entries = workerQueue->entries[priority];
+	if(entries.isEmpty()) {
+	  continue;
+	}
+	info = (a == 0?entries.takeFirst():entries.takeLast());
+	pending[priority].fetchAndSubRelaxed(1);
+	return true;
+      }
+    }
+  }
+  return false;
 }
 
-void Queue::clearAll()
+int Queue::getPending(const int &priority)
 {
-  queueMutex.lock();
-  clear();
-  queueMutex.unlock();
+  return pending[priority].loadAcquire();
+}
+
+void Queue::cancel()
+{
+  cancelled.storeRelease(1);
+}
+
+bool Queue::isCancelled()
+{
+  return cancelled.loadAcquire();
 }
 
 void Queue::filterFiles(const QString &patterns, const bool &include)
 {
   QList<QString> regExpPatterns = getRegExpPatterns(patterns);
 
-  queueMutex.lock();
   QMutableListIterator<QFileInfo> it(*this);
   while(it.hasNext()) {
     QFileInfo info = it.next();
@@ -76,23 +113,20 @@ void Queue::filterFiles(const QString &patterns, const bool &include)
       it.remove();
     }
   }
-  queueMutex.unlock();
 }
 
 void Queue::removeFiles(const QList<QString> &files)
 {
-  queueMutex.lock();
+  QSet<QString> fileSet;
+  for(const auto &file: files) {
+    fileSet.insert(file);
+  }
   QMutableListIterator<QFileInfo> it(*this);
   while(it.hasNext()) {
-    QFileInfo info = it.next();
-    for(const auto &file: files) {
-      if(info.absoluteFilePath() == file) {
-	it.remove();
-	break;
-      }
+    if(fileSet.contains(it.next().absoluteFilePath())) {
+      it.remove();
     }
   }
-  queueMutex.unlock();
 }
 
 QList<QString> Queue::getRegExpPatterns(QString patterns)
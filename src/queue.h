@@ -29,19 +29,42 @@
 #include <QList>
 #include <QFileInfo>
 #include <QMutex>
+#include <QAtomicInt>
+#include <QSharedPointer>
 
+#include <functional>
+
+// Entry priorities, lower is taken first
+constexpr int PRIOCACHED = 0; // Resolved from the local cache, no network needed
+constexpr int PRIONEW = 1; // Not in the cache yet
+constexpr int PRIOREFRESH = 2; // In the cache, but fetched again
+constexpr int PRIORITIES = 3;
+
+struct WorkerQueue
+{
+  QMutex mutex;
+  QList<QFileInfo> entries[PRIORITIES];
+};
+
+// Entries are added and filtered as a plain list while setting up. 'distribute()' then
+// hands them out to per-worker queues that the workers take from and steal from each other
 class Queue : public QList<QFileInfo>
 {
 public:
   Queue();
-  bool hasEntry();
-  QFileInfo takeEntry();
-  void clearAll();
+  void distribute(const int &workers,
+		  const std::function<int(const QFileInfo &)> &getPriority = nullptr);
+  bool takeEntry(const int &worker, QFileInfo &info, const int &maxPriority = PRIORITIES - 1);
+  int getPending(const int &priority);
+  void cancel();
+  bool isCancelled();
   void filterFiles(const QString &patterns, const bool &include = false);
   void removeFiles(const QList<QString> &files);
 
 private:
-  QMutex queueMutex;
+  QList<QSharedPointer<WorkerQueue> > workerQueues;
+  QAtomicInt pending[PRIORITIES];
+  QAtomicInt cancelled;
   QList<QString> getRegExpPatterns(QString patterns);
 
 };
@@ -26,12 +26,15 @@
 #include <iostream>
 #include <QTimer>
 #include <QRegularExpression>
+#include <QtConcurrent>
+#include <QElapsedTimer>
 
 #include "scraperworker.h"
 #include "strtools.h"
 #include "nametools.h"
 #include "settings.h"
 #include "compositor.h"
+#include "filetools.h"
 
 #include "openretro.h"
 #include "thegamesdb.h"
@@ -44,12 +47,21 @@
 #include "arcadedb.h"
 #include "esgamelist.h"
 
+// Number of entries each worker can have waiting in the processing stage before it blocks
+constexpr int PENDINGMAX = 2;
+
 ScraperWorker::ScraperWorker(QSharedPointer<Queue> queue,
 			     QSharedPointer<Cache> cache,
 			     QSharedPointer<NetManager> manager,
+			     QThreadPool *processPool,
+			     QThreadPool *compositePool,
+			     StageTimings *timings,
 			     Settings config,
-			     QString threadId)
-  : config(config), cache(cache), manager(manager), queue(queue), threadId(threadId)
+			     QString threadId,
+			     int maxPriority)
+  : config(config), cache(cache), manager(manager), queue(queue), processPool(processPool),
+    compositePool(compositePool), timings(timings), threadId(threadId), maxPriority(maxPriority),
+    pending(PENDINGMAX)
 {
 }
 
@@ -59,7 +71,13 @@ ScraperWorker::~ScraperWorker()
 
 void ScraperWorker::run()
 {
-  if(config.scraper == "openretro") {
+  // Workers that only take cache hits never search or fetch game data, so they skip building the
+  // scraping module with its rate limits and maps. The local modules resolve every entry
+  // themselves, so those still need theirs
+  if(maxPriority == PRIOCACHED && config.scraper != "cache" &&
+     config.scraper != "import" && config.scraper != "esgamelist") {
+    scraper = new AbstractScraper(&config, manager);
+  } else if(config.scraper == "openretro") {
     scraper = new OpenRetro(&config, manager);
   } else if(config.scraper == "thegamesdb") {
     scraper = new TheGamesDb(&config, manager);
@@ -88,24 +106,21 @@ void ScraperWorker::run()
   }
   platformOrig = config.platform;
 
+  // Parse and compile the artwork xml up front so errors are caught before any scraping is done
   Compositor compositor(&config);
   if(!compositor.processXml()) {
     printf("Something went wrong when parsing artwork xml from '%s', please check the file for errors. Now exiting...\n", config.artworkConfig.toStdString().c_str());
     exit(1);
   }
+  renderPlan = compositor.getPlan();
 
-  while(queue->hasEntry()) {
-    // takeEntry() also unlocks the mutex that was locked in hasEntry()
-    QFileInfo info = queue->takeEntry();
+  QFileInfo info;
+  while(queue->takeEntry(threadId.toInt() - 1, info, maxPriority)) {
     // Reset platform in case we have manipulated it (such as changing 'amiga' to 'cd32')
     config.platform = platformOrig;
     QString output = "\033[1;33m(T" + threadId + ")\033[0m ";
     QString debug = "";
-    QString cacheId = cache->getQuickId(info);
-    if(cacheId.isEmpty()) {
-      cacheId = NameTools::getCacheId(info);
-      cache->addQuickId(info, cacheId);
-    }
+    QString cacheId = cache->getCacheId(info);
     QString compareTitle = scraper->getCompareTitle(info);
 
     // For Amiga platform, change to subplatforms if detected as such
@@ -166,7 +181,10 @@ void ScraperWorker::run()
 	}
 	gameEntries.append(cachedGame);
       } else {
+	QElapsedTimer searchTimer;
+	searchTimer.start();
 	scraper->runPasses(gameEntries, info, output, debug);
+	timings->search.fetchAndAddRelaxed(searchTimer.elapsed());
       }
     }
     
@@ -233,142 +251,190 @@ void ScraperWorker::run()
     output.append("\033[1;34m---- Game '" + info.completeBaseName() + "' found! :) ----\033[0m\n");
     
     if(!fromCache) {
+      QElapsedTimer gameDataTimer;
+      gameDataTimer.start();
       scraper->getGameData(game);
+      timings->gameData.fetchAndAddRelaxed(gameDataTimer.elapsed());
+    }
+
+    ProcessJob job;
+    job.game = game;
+    job.info = info;
+    job.config = config;
+    job.output = output;
+    job.debug = debug;
+    job.compareTitle = compareTitle;
+    job.fromCache = fromCache;
+    job.searchMatch = searchMatch;
+    if(!forceEnd) {
+      forceEnd = limitReached(job.limitOutput);
+    }
+    // Blocks if this worker already has PENDINGMAX entries waiting for processing
+    pending.acquire();
+    QtConcurrent::run(processPool, [this, job]() mutable {
+	QElapsedTimer processTimer;
+	processTimer.start();
+	processEntry(job);
+	timings->processing.fetchAndAddRelaxed(processTimer.elapsed());
+	pending.release();
+      });
+    if(forceEnd) {
+      break;
     }
+  }
 
-    if(!config.pretend && config.scraper == "cache") {
-      // Process all artwork
-      compositor.saveAll(game, info.completeBaseName());
-      // Copy or symlink videos as requested
-      if(config.videos &&
-	 game.videoFormat != "" &&
-	 !game.videoFile.isEmpty() &&
-	 QFile::exists(game.videoFile)) {
-	QString videoDst = config.videosFolder + "/" + info.completeBaseName() + "." + game.videoFormat;
-	if(config.skipExistingVideos && QFile::exists(videoDst)) {
-	} else {
-	  if(QFile::exists(videoDst)) {
-	    QFile::remove(videoDst);
+  // Wait for the processing stage to finish all entries from this worker
+  pending.acquire(PENDINGMAX);
+  pending.release(PENDINGMAX);
+
+  delete scraper;
+  emit allDone();
+}
+
+// Second stage of the pipeline, runs in the shared processing pool while the worker thread
+// moves on to the network requests for the next rom
+void ScraperWorker::processEntry(ProcessJob &job)
+{
+  GameEntry &game = job.game;
+  const QFileInfo &info = job.info;
+  QString &output = job.output;
+
+  // Each entry gets its own compositor since they run in parallel. The outputs are rendered and
+  // saved in the compositing pool while this entry is processed further, and are waited for
+  // before the entry is handed over
+  Compositor compositor(&job.config, compositePool);
+  QList<SavedOutput> savedOutputs;
+  if(!job.config.pretend && job.config.scraper == "cache") {
+    // Process all artwork
+    compositor.setPlan(renderPlan);
+    savedOutputs = compositor.saveAll(game, info.completeBaseName());
+    // Copy or symlink videos as requested
+    if(job.config.videos &&
+       game.videoFormat != "" &&
+       !game.videoFile.isEmpty() &&
+       QFile::exists(game.videoFile)) {
+      QString videoDst = job.config.videosFolder + "/" + info.completeBaseName() + "." + game.videoFormat;
+      if(job.config.skipExistingVideos && QFile::exists(videoDst)) {
+      } else {
+	if(QFile::exists(videoDst)) {
+	  QFile::remove(videoDst);
+	}
+	if(job.config.symlink) {
+	  // Try to remove existing video destination file before linking
+	  if(!QFile::link(game.videoFile, videoDst)) {
+	    game.videoFormat = "";
 	  }
-	  if(config.symlink) {
-	    // Try to remove existing video destination file before linking
-	    if(!QFile::link(game.videoFile, videoDst)) {
-	      game.videoFormat = "";
-	    }
-	  } else {
-	    QFile videoFile(videoDst);
-	    if(videoFile.open(QIODevice::WriteOnly)) {
-	      videoFile.write(game.videoData);
-	      videoFile.close();
-	    } else {
-	      game.videoFormat = "";
-	    }
+	} else {
+	  // Never read the video into memory, let the filesystem copy or link it
+	  if(!FileTools::exportFile(game.videoFile, videoDst, job.config.hardlink)) {
+	    game.videoFormat = "";
 	  }
 	}
       }
     }
-    
-    // Add all resources to the cache
-    QString cacheOutput = "";
-    if(config.scraper != "cache" && game.found && !fromCache) {
-      game.source = config.scraper;
-      cache->addResources(game, config, cacheOutput);
-    }
-
-    // We're done saving the raw data at this point, so feel free to manipulate game resources to better suit game list creation from here on out.
+  }
+  
+  // Add all resources to the cache. Downloaded videos are moved into it, so get their size first
+  QString cacheOutput = "";
+  qint64 videoSize = game.videoData.size();
+  if(job.config.scraper != "cache" && game.found && !job.fromCache) {
+    if(!game.getMediaFile(VIDEO).isEmpty()) {
+      videoSize = QFileInfo(game.getMediaFile(VIDEO)).size();
+    }
+    game.source = job.config.scraper;
+    cache->addResources(game, job.config, cacheOutput);
+  }
 
-    // Strip any brackets from the title as they will be readded when assembling gamelist
-    game.title = StrTools::stripBrackets(game.title);
+  // We're done saving the raw data at this point, so feel free to manipulate game resources to better suit game list creation from here on out.
 
-    // Move 'The' or ', The' depending on the config. This does not affect game list sorting. 'The ' is always removed before sorting.
-    if(config.theInFront) {
-      QRegularExpression theMatch(", [Tt]{1}he");
-      if(theMatch.match(game.title).hasMatch()) {
-	game.title.replace(theMatch.match(game.title).captured(0), "");
-	game.title.prepend("The ");
-      }
-    } else {
-      if(game.title.toLower().left(4) == "the ") {
-	game.title = game.title.remove(0, 4).simplified().append(", The");
-      }
-    }
+  // Strip any brackets from the title as they will be readded when assembling gamelist
+  game.title = StrTools::stripBrackets(game.title);
 
-    // Don't unescape title since we already did that in getBestEntry()
-    game.videoFile = StrTools::xmlUnescape(config.videosFolder + "/" + info.completeBaseName() + "." + game.videoFormat);
-    game.description = StrTools::xmlUnescape(game.description);
-    game.releaseDate = StrTools::xmlUnescape(game.releaseDate);
-    // Make sure we have the correct 'yyyymmdd' format of 'releaseDate'
-    game.releaseDate = StrTools::conformReleaseDate(game.releaseDate);
-    game.developer = StrTools::xmlUnescape(game.developer);
-    game.publisher = StrTools::xmlUnescape(game.publisher);
-    game.tags = StrTools::xmlUnescape(game.tags);
-    game.tags = StrTools::conformTags(game.tags);
-    game.rating = StrTools::xmlUnescape(game.rating);
-    game.players = StrTools::xmlUnescape(game.players);
-    // Make sure we have the correct single digit format of 'players'
-    game.players = StrTools::conformPlayers(game.players);
-    game.ages = StrTools::xmlUnescape(game.ages);
-    // Make sure we have the correct format of 'ages'
-    game.ages = StrTools::conformAges(game.ages);
-
-    output.append("Scraper:        " + config.scraper + "\n");
-    if(config.scraper != "cache" && config.scraper != "import") {
-      output.append("From cache:     " + QString((fromCache?"YES (refresh from source with '--cache refresh')":"NO")) + "\n");
-      output.append("Search match:   " + QString::number(searchMatch) + " %\n");
-      output.append("Compare title:  '\033[1;32m" + compareTitle + "\033[0m'\n");
-      output.append("Result title:   '\033[1;32m" + game.title + "\033[0m' (" + game.titleSrc + ")\n");
-    } else {
-      output.append("Title:          '\033[1;32m" + game.title + "\033[0m' (" + game.titleSrc + ")\n");
-    }
-    if(!config.nameTemplate.isEmpty()) {
-      game.title = StrTools::xmlUnescape(NameTools::getNameFromTemplate(game,
-									config.nameTemplate));
-    } else {
-      game.title = StrTools::xmlUnescape(game.title);
-      if(config.forceFilename) {
-	game.title = StrTools::xmlUnescape(StrTools::stripBrackets(info.completeBaseName()));
-      }
-      if(config.brackets) {
-	game.title.append(StrTools::xmlUnescape((game.parNotes != ""?" " + game.parNotes:"") + (game.sqrNotes != ""?" " + game.sqrNotes:"")));
-      }
-    }
-    output.append("Platform:       '\033[1;32m" + game.platform + "\033[0m' (" + game.platformSrc + ")\n");
-    output.append("Release Date:   '\033[1;32m");
-    if(game.releaseDate.isEmpty()) {
-      output.append("\033[0m' ()\n");
-    } else {
-      output.append(QDate::fromString(game.releaseDate, "yyyyMMdd").toString("yyyy-MM-dd") + "\033[0m' (" + game.releaseDateSrc + ")\n");
+  // Move 'The' or ', The' depending on the job.config. This does not affect game list sorting. 'The ' is always removed before sorting.
+  if(job.config.theInFront) {
+    QRegularExpression theMatch(", [Tt]{1}he");
+    if(theMatch.match(game.title).hasMatch()) {
+      game.title.replace(theMatch.match(game.title).captured(0), "");
+      game.title.prepend("The ");
     }
-    output.append("Developer:      '\033[1;32m" + game.developer + "\033[0m' (" + game.developerSrc + ")\n");
-    output.append("Publisher:      '\033[1;32m" + game.publisher + "\033[0m' (" + game.publisherSrc + ")\n");
-    output.append("Players:        '\033[1;32m" + game.players + "\033[0m' (" + game.playersSrc + ")\n");
-    output.append("Ages:           '\033[1;32m" + game.ages + (game.ages.toInt() != 0?"+":"") + "\033[0m' (" + game.agesSrc + ")\n");
-    output.append("Tags:           '\033[1;32m" + game.tags + "\033[0m' (" + game.tagsSrc + ")\n");
-    output.append("Rating (0-1):   '\033[1;32m" + game.rating + "\033[0m' (" + game.ratingSrc + ")\n");
-    output.append("Cover:          " + QString((game.coverData.isNull()?"\033[1;31mNO":"\033[1;32mYES")) + "\033[0m" + QString((config.cacheCovers || config.scraper == "cache"?"":" (uncached)")) + " (" + game.coverSrc + ")\n");
-    output.append("Screenshot:     " + QString((game.screenshotData.isNull()?"\033[1;31mNO":"\033[1;32mYES")) + "\033[0m" + QString((config.cacheScreenshots || config.scraper == "cache"?"":" (uncached)")) + " (" + game.screenshotSrc + ")\n");
-    output.append("Wheel:          " + QString((game.wheelData.isNull()?"\033[1;31mNO":"\033[1;32mYES")) + "\033[0m" + QString((config.cacheWheels || config.scraper == "cache"?"":" (uncached)")) + " (" + game.wheelSrc + ")\n");
-    output.append("Marquee:        " + QString((game.marqueeData.isNull()?"\033[1;31mNO":"\033[1;32mYES")) + "\033[0m" + QString((config.cacheMarquees || config.scraper == "cache"?"":" (uncached)")) + " (" + game.marqueeSrc + ")\n");
-    if(config.videos) {
-      output.append("Video:          " + QString((game.videoFormat.isEmpty()?"\033[1;31mNO":"\033[1;32mYES")) + "\033[0m" + QString((game.videoData.size() <= config.videoSizeLimit?"":" (size exceeded, uncached)")) + " (" + game.videoSrc + ")\n");
-    }
-    output.append("\nDescription: (" + game.descriptionSrc + ")\n'\033[1;32m" + game.description.left(config.maxLength) + "\033[0m'\n");
-    if(!cacheOutput.isEmpty()) {
-      output.append("\n\033[1;33mCache output:\033[0m\n" + cacheOutput + "\n");
+  } else {
+    if(game.title.toLower().left(4) == "the ") {
+      game.title = game.title.remove(0, 4).simplified().append(", The");
     }
-    if(!forceEnd) {
-      forceEnd = limitReached(output);
+  }
+
+  // Don't unescape title since we already did that in getBestEntry()
+  game.videoFile = StrTools::xmlUnescape(job.config.videosFolder + "/" + info.completeBaseName() + "." + game.videoFormat);
+  game.description = StrTools::xmlUnescape(game.description);
+  game.releaseDate = StrTools::xmlUnescape(game.releaseDate);
+  // Make sure we have the correct 'yyyymmdd' format of 'releaseDate'
+  game.releaseDate = StrTools::conformReleaseDate(game.releaseDate);
+  game.developer = StrTools::xmlUnescape(game.developer);
+  game.publisher = StrTools::xmlUnescape(game.publisher);
+  game.tags = StrTools::xmlUnescape(game.tags);
+  game.tags = StrTools::conformTags(game.tags);
+  game.rating = StrTools::xmlUnescape(game.rating);
+  game.players = StrTools::xmlUnescape(game.players);
+  // Make sure we have the correct single digit format of 'players'
+  game.players = StrTools::conformPlayers(game.players);
+  game.ages = StrTools::xmlUnescape(game.ages);
+  // Make sure we have the correct format of 'ages'
+  game.ages = StrTools::conformAges(game.ages);
+
+  output.append("Scraper:        " + job.config.scraper + "\n");
+  if(job.config.scraper != "cache" && job.config.scraper != "import") {
+    output.append("From cache:     " + QString((job.fromCache?"YES (refresh from source with '--cache refresh')":"NO")) + "\n");
+    output.append("Search match:   " + QString::number(job.searchMatch) + " %\n");
+    output.append("Compare title:  '\033[1;32m" + job.compareTitle + "\033[0m'\n");
+    output.append("Result title:   '\033[1;32m" + game.title + "\033[0m' (" + game.titleSrc + ")\n");
+  } else {
+    output.append("Title:          '\033[1;32m" + game.title + "\033[0m' (" + game.titleSrc + ")\n");
+  }
+  if(!job.config.nameTemplate.isEmpty()) {
+    game.title = StrTools::xmlUnescape(NameTools::getNameFromTemplate(game,
+								      job.config.nameTemplate));
+  } else {
+    game.title = StrTools::xmlUnescape(game.title);
+    if(job.config.forceFilename) {
+      game.title = StrTools::xmlUnescape(StrTools::stripBrackets(info.completeBaseName()));
     }
-    game.calculateCompleteness();
-    game.resetMedia();
-    emit entryReady(game, output, debug);
-    if(forceEnd) {
-      break;
+    if(job.config.brackets) {
+      game.title.append(StrTools::xmlUnescape((game.parNotes != ""?" " + game.parNotes:"") + (game.sqrNotes != ""?" " + game.sqrNotes:"")));
     }
   }
-
-  delete scraper;
-  emit allDone();
+  output.append("Platform:       '\033[1;32m" + game.platform + "\033[0m' (" + game.platformSrc + ")\n");
+  output.append("Release Date:   '\033[1;32m");
+  if(game.releaseDate.isEmpty()) {
+    output.append("\033[0m' ()\n");
+  } else {
+    output.append(QDate::fromString(game.releaseDate, "yyyyMMdd").toString("yyyy-MM-dd") + "\033[0m' (" + game.releaseDateSrc + ")\n");
+  }
+  output.append("Developer:      '\033[1;32m" + game.developer + "\033[0m' (" + game.developerSrc + ")\n");
+  output.append("Publisher:      '\033[1;32m" + game.publisher + "\033[0m' (" + game.publisherSrc + ")\n");
+  output.append("Players:        '\033[1;32m" + game.players + "\033[0m' (" + game.playersSrc + ")\n");
+  output.append("Ages:           '\033[1;32m" + game.ages + (game.ages.toInt() != 0?"+":"") + "\033[0m' (" + game.agesSrc + ")\n");
+  output.append("Tags:           '\033[1;32m" + game.tags + "\033[0m' (" + game.tagsSrc + ")\n");
+  output.append("Rating (0-1):   '\033[1;32m" + game.rating + "\033[0m' (" + game.ratingSrc + ")\n");
+  output.append("Cover:          " + QString((!game.hasMedia(COVER)?"\033[1;31mNO":"\033[1;32mYES")) + "\033[0m" + QString((job.config.cacheCovers || job.config.scraper == "cache"?"":" (uncached)")) + " (" + game.coverSrc + ")\n");
+  output.append("Screenshot:     " + QString((!game.hasMedia(SCREENSHOT)?"\033[1;31mNO":"\033[1;32mYES")) + "\033[0m" + QString((job.config.cacheScreenshots || job.config.scraper == "cache"?"":" (uncached)")) + " (" + game.screenshotSrc + ")\n");
+  output.append("Wheel:          " + QString((!game.hasMedia(WHEEL)?"\033[1;31mNO":"\033[1;32mYES")) + "\033[0m" + QString((job.config.cacheWheels || job.config.scraper == "cache"?"":" (uncached)")) + " (" + game.wheelSrc + ")\n");
+  output.append("Marquee:        " + QString((!game.hasMedia(MARQUEE)?"\033[1;31mNO":"\033[1;32mYES")) + "\033[0m" + QString((job.config.cacheMarquees || job.config.scraper == "cache"?"":" (uncached)")) + " (" + game.marqueeSrc + ")\n");
+  if(job.config.videos) {
+    output.append("Video:          " + QString((game.videoFormat.isEmpty()?"\033[1;31mNO":"\033[1;32mYES")) + "\033[0m" + QString((videoSize <= job.config.videoSizeLimit?"":" (size exceeded, uncached)")) + " (" + game.videoSrc + ")\n");
+  }
+  output.append("\nDescription: (" + game.descriptionSrc + ")\n'\033[1;32m" + game.description.left(job.config.maxLength) + "\033[0m'\n");
+  if(!cacheOutput.isEmpty()) {
+    output.append("\n\033[1;33mCache output:\033[0m\n" + cacheOutput + "\n");
+  }
+  output.append(job.limitOutput);
+  Compositor::finishAll(game, savedOutputs);
+  if(!job.config.pretend && job.config.scraper == "cache") {
+    job.debug.append("Decoded " + QString::number(compositor.decodes) + " image(s) in " +
+		     QString::number(compositor.decodeTime / 1000000.0, 'f', 2) + " ms\n");
+  }
+  game.calculateCompleteness();
+  game.resetMedia();
+  emit entryReady(game, output, job.debug);
 }
 
 bool ScraperWorker::limitReached(QString &output)
@@ -31,10 +31,37 @@
 #include "cache.h"
 #include "queue.h"
 #include "netmanager.h"
+#include "compositor.h"
 
 #include <QImage>
 #include <QDir>
 #include <QThread>
+#include <QThreadPool>
+#include <QSemaphore>
+#include <QAtomicInteger>
+
+struct ProcessJob
+{
+  GameEntry game;
+  QFileInfo info;
+  Settings config;
+  QString output;
+  QString debug;
+  QString compareTitle;
+  QString limitOutput;
+  bool fromCache = false;
+  int searchMatch = 0;
+};
+
+// Time spent in each stage of the scraping run in ms. The rom checksums are computed in parallel
+// before the workers start, so 'cacheIds' is wall time. The other stages are summed over all threads
+struct StageTimings
+{
+  QAtomicInteger<qint64> cacheIds;
+  QAtomicInteger<qint64> search;
+  QAtomicInteger<qint64> gameData;
+  QAtomicInteger<qint64> processing;
+};
 
 class ScraperWorker : public QObject
 {
@@ -44,8 +71,12 @@ public:
   ScraperWorker(QSharedPointer<Queue> queue,
 		QSharedPointer<Cache> cache,
 		QSharedPointer<NetManager> manager,
+		QThreadPool *processPool,
+		QThreadPool *compositePool,
+		StageTimings *timings,
 		Settings config,
-		QString threadId);
+		QString threadId,
+		int maxPriority = PRIORITIES - 1);
   ~ScraperWorker();
   void run();
   bool forceEnd = false;
@@ -62,9 +93,19 @@ private:
   QSharedPointer<Cache> cache;
   QSharedPointer<NetManager> manager;
   QSharedPointer<Queue> queue;
+  QThreadPool *processPool;
+  QThreadPool *compositePool;
+  StageTimings *timings;
 
   QString platformOrig;
   QString threadId;
+  int maxPriority; // Only take queue entries up to this priority
+
+  // artwork.xml compiled once, every entry is rendered from it
+  QList<RenderOutput> renderPlan;
+
+  QSemaphore pending;
+  void processEntry(ProcessJob &job);
 
   unsigned int editDistance(const std::string& s1, const std::string& s2);
 
@@ -29,7 +29,7 @@
 
 #include "screenscraper.h"
 #include "strtools.h"
-#include "crc32.h"
+#include "digest.h"
 
 constexpr int RETRIESMAX = 4;
 constexpr int MINARTSIZE = 256;
@@ -38,12 +38,11 @@ ScreenScraper::ScreenScraper(Settings *config,
 			     QSharedPointer<NetManager> manager)
   : AbstractScraper(config, manager)
 {
-  connect(&limitTimer, &QTimer::timeout, &limiter, &QEventLoop::quit);
-  limitTimer.setInterval(1200); // 1.2 second request limit set a bit above 1.0 as requested by the good folks at ScreenScraper. Don't change!
-  limitTimer.setSingleShot(false);
-  limitTimer.start();
+  // 'baseUrl' can point the module at a stand-in server for load testing
+  baseUrl = (config->baseUrl.isEmpty()?"https://www.screenscraper.fr":config->baseUrl);
 
-  baseUrl = "http://www.screenscraper.fr";
+  // One request per 1.2 seconds per allowed thread, set a bit above 1.0 as requested by the good folks at ScreenScraper. Don't change!
+  manager->setRateLimit((config->baseUrl.isEmpty()?"screenscraper.fr":QUrl(baseUrl).host()), getRequestRate(config->threads / 1.2), config->threads);
 
   fetchOrder.append(PUBLISHER);
   fetchOrder.append(DEVELOPER);
@@ -70,10 +69,11 @@ void ScreenScraper::getSearchResults(QList<GameEntry> &gameEntries,
     return;
   }
 
-  QString gameUrl = "https://www.screenscraper.fr/api2/jeuInfos.php?devid=muldjord&devpassword=" + StrTools::unMagic("204;198;236;130;203;181;203;126;191;167;200;198;192;228;169;156") + "&softname=skyscraper" VERSION + (config->user.isEmpty()?"":"&ssid=" + config->user) + (config->password.isEmpty()?"":"&sspassword=" + config->password) + (platformId.isEmpty()?"":"&systemeid=" + platformId) + "&output=json&" + searchName;
+  QString gameUrl = baseUrl + "/api2/jeuInfos.php?devid=muldjord&devpassword=" + StrTools::unMagic("204;198;236;130;203;181;203;126;191;167;200;198;192;228;169;156") + "&softname=skyscraper" VERSION + (config->user.isEmpty()?"":"&ssid=" + config->user) + (config->password.isEmpty()?"":"&sspassword=" + config->password) + (platformId.isEmpty()?"":"&systemeid=" + platformId) + "&output=json&" + searchName;
 
+  // Transport errors are already retried with backoff by NetComm. This loop only retries when
+  // ScreenScraper replies that all threads for unregistered users are in use
   for(int retries = 0; retries < RETRIESMAX; ++retries) {
-    limiter.exec();
     netComm->request(gameUrl);
     q.exec();
     data = netComm->getData();
@@ -81,30 +81,35 @@ void ScreenScraper::getSearchResults(QList<GameEntry> &gameEntries,
     QByteArray headerData = data.left(1024); // Minor optimization with minimal more RAM usage
     // Do error checks on headerData. It's more stable than checking the potentially faulty JSON
     if(headerData.isEmpty()) {
-      printf("\033[1;33mRetrying request...\033[0m\n\n");
-      continue;
+      return;
     } else if(headerData.contains("non trouvée")) {
       return;
     } else if(headerData.contains("API totalement fermé")) {
       printf("\033[1;31mThe ScreenScraper API is currently closed, exiting nicely...\033[0m\n\n");
+      netComm->forgetReply();
       reqRemaining = 0;
       return;
     } else if(headerData.contains("Le logiciel de scrape utilisé a été blacklisté")) {
       printf("\033[1;31mSkyscraper has apparently been blacklisted at ScreenScraper, exiting nicely...\033[0m\n\n");
+      netComm->forgetReply();
       reqRemaining = 0;
       return;
     } else if(headerData.contains("Votre quota de scrape est")) {
       printf("\033[1;31mYour daily ScreenScraper request limit has been reached, exiting nicely...\033[0m\n\n");
+      netComm->forgetReply();
       reqRemaining = 0;
       return;
     } else if(headerData.contains("API fermé pour les non membres") ||
 	      headerData.contains("API closed for non-registered members") ||
 	      headerData.contains("****T****h****e**** ****m****a****x****i****m****u****m**** ****t****h****r****e****a****d****s**** ****a****l****l****o****w****e****d**** ****t****o**** ****l****e****e****c****h****e****r**** ****u****s****e****r****s**** ****i****s**** ****a****l****r****e****a****d****y**** ****u****s****e****d****")) {
       printf("\033[1;31mThe screenscraper service is currently closed or too busy to handle requests from unregistered and inactive users. Sign up for an account at https://www.screenscraper.fr and contribute to gain more threads. Then use the credentials with Skyscraper using the '-u user:pass' command line option or by setting 'userCreds=\"user:pass\"' in '/home/USER/.skyscraper/config.ini'.\033[0m\n\n");
+      // Otherwise the retry, and the threads asking for the same game after us, get this reply again
+      netComm->forgetReply();
       if(retries == RETRIESMAX - 1) {
 	reqRemaining = 0;
 	return;
       } else {
+	netComm->waitBackoff(retries);
 	continue;
       }
     }
@@ -117,6 +122,7 @@ void ScreenScraper::getSearchResults(QList<GameEntry> &gameEntries,
 
     // Check if we got a valid JSON document back
     if(jsonObj.isEmpty()) {
+      netComm->forgetReply();
       printf("\033[1;31mScreenScraper APIv2 returned invalid / empty Json. Their servers are probably down. Please try again later or use a different scraping module with '-s MODULE'. Check 'Skyscraper --help' for more information.\033[0m\n");
       data.replace(StrTools::unMagic("204;198;236;130;203;181;203;126;191;167;200;198;192;228;169;156"), "****");
       data.replace(config->password.toUtf8(), "****");
@@ -133,11 +139,11 @@ void ScreenScraper::getSearchResults(QList<GameEntry> &gameEntries,
 
     // Check if the request was successful
     if(jsonObj["header"].toObject()["success"].toString() != "true") {
+      netComm->forgetReply();
       printf("Request returned a success state of '%s'. Error was:\n%s\n",
 	     jsonObj["header"].toObject()["success"].toString().toStdString().c_str(),
 	     jsonObj["header"].toObject()["error"].toString().toStdString().c_str());
-      // Try again. We handle important errors above, so something weird is going on here
-      continue;
+      return;
     }
     
     // Check if user has exceeded daily request limit
@@ -148,11 +154,7 @@ void ScreenScraper::getSearchResults(QList<GameEntry> &gameEntries,
       }
     }
 
-    // Check if we got a game entry back
-    if(jsonObj["response"].toObject().contains("jeu")) {
-      // Game found, stop retrying
-      break;
-    }
+    break;
   }
 
   jsonObj = jsonObj["response"].toObject()["jeu"].toObject();
@@ -238,6 +240,7 @@ void ScreenScraper::getGameData(GameEntry &game)
       ;
     }
   }
+  fetchMedia(game, 1, MINARTSIZE);
 }
 
 void ScreenScraper::getReleaseDate(GameEntry &game)
@@ -316,7 +319,7 @@ void ScreenScraper::getTags(GameEntry &game)
   game.tags = game.tags.left(game.tags.length() - 2);
 }
 
-void ScreenScraper::getCover(GameEntry &game)
+void ScreenScraper::getCover(GameEntry &)
 {
   QString url = "";
   if(config->platform == "arcade" ||
@@ -329,95 +332,35 @@ void ScreenScraper::getCover(GameEntry &game)
     url = getJsonText(jsonObj["medias"].toArray(), REGION, QList<QString>({"box-2D"}));
   }
   if(!url.isEmpty()) {
-    bool moveOn = true;
-    for(int retries = 0; retries < RETRIESMAX; ++retries) {
-      limiter.exec();
-      netComm->request(url);
-      q.exec();
-      QImage image;
-      if(netComm->getError(config->verbosity) == QNetworkReply::NoError &&
-	 netComm->getData().size() >= MINARTSIZE &&
-	 image.loadFromData(netComm->getData())) {
-	game.coverData = netComm->getData();
-      } else {
-	moveOn = false;
-      }
-      if(moveOn)
-	break;
-    }
+    addMediaRequest(COVER, url);
   }
 }
 
-void ScreenScraper::getScreenshot(GameEntry &game)
+void ScreenScraper::getScreenshot(GameEntry &)
 {
   QString url = getJsonText(jsonObj["medias"].toArray(), REGION, QList<QString>({"ss", "sstitle"}));
   if(!url.isEmpty()) {
-    bool moveOn = true;
-    for(int retries = 0; retries < RETRIESMAX; ++retries) {
-      limiter.exec();
-      netComm->request(url);
-      q.exec();
-      QImage image;
-      if(netComm->getError(config->verbosity) == QNetworkReply::NoError &&
-	 netComm->getData().size() >= MINARTSIZE &&
-	 image.loadFromData(netComm->getData())) {
-	game.screenshotData = netComm->getData();
-      } else {
-	moveOn = false;
-      }
-      if(moveOn)
-	break;
-    }
+    addMediaRequest(SCREENSHOT, url);
   }
 }
 
-void ScreenScraper::getWheel(GameEntry &game)
+void ScreenScraper::getWheel(GameEntry &)
 {
   QString url = getJsonText(jsonObj["medias"].toArray(), REGION, QList<QString>({"wheel", "wheel-hd"}));
   if(!url.isEmpty()) {
-    bool moveOn = true;
-    for(int retries = 0; retries < RETRIESMAX; ++retries) {
-      limiter.exec();
-      netComm->request(url);
-      q.exec();
-      QImage image;
-      if(netComm->getError(config->verbosity) == QNetworkReply::NoError &&
-	 netComm->getData().size() >= MINARTSIZE &&
-	 image.loadFromData(netComm->getData())) {
-	game.wheelData = netComm->getData();
-      } else {
-	moveOn = false;
-      }
-      if(moveOn)
-	break;
-    }
+    addMediaRequest(WHEEL, url);
   }
 }
 
-void ScreenScraper::getMarquee(GameEntry &game)
+void ScreenScraper::getMarquee(GameEntry &)
 {
   QString url = getJsonText(jsonObj["medias"].toArray(), REGION, QList<QString>({"screenmarquee"}));
   if(!url.isEmpty()) {
-    bool moveOn = true;
-    for(int retries = 0; retries < RETRIESMAX; ++retries) {
-      limiter.exec();
-      netComm->request(url);
-      q.exec();
-      QImage image;
-      if(netComm->getError(config->verbosity) == QNetworkReply::NoError &&
-	 netComm->getData().size() >= MINARTSIZE &&
-	 image.loadFromData(netComm->getData())) {
-	game.marqueeData = netComm->getData();
-      } else {
-	moveOn = false;
-      }
-      if(moveOn)
-	break;
-    }
+    addMediaRequest(MARQUEE, url);
   }
 }
 
-void ScreenScraper::getVideo(GameEntry &game)
+void ScreenScraper::getVideo(GameEntry &)
 {
   QStringList types;
   if(config->videoPreferNormalized) {
@@ -426,41 +369,22 @@ void ScreenScraper::getVideo(GameEntry &game)
   types.append("video");
   QString url = getJsonText(jsonObj["medias"].toArray(), NONE, types);
   if(!url.isEmpty()) {
-    bool moveOn = true;
-    for(int retries = 0; retries < RETRIESMAX; ++retries) {
-      limiter.exec();
-      netComm->request(url);
-      q.exec();
-      game.videoData = netComm->getData();
-      // Make sure received data is actually a video file
-      QByteArray contentType = netComm->getContentType();
-      if(netComm->getError(config->verbosity) == QNetworkReply::NoError &&
-	 contentType.contains("video/") &&
-	 game.videoData.size() > 4096) {
-	game.videoFormat = contentType.mid(contentType.indexOf("/") + 1,
-					   contentType.length() - contentType.indexOf("/") + 1);
-      } else {
-	game.videoData = "";
-	moveOn = false;
-      }
-      if(moveOn)
-	break;
-    }
+    // The video format is taken from the content type of the reply
+    addMediaRequest(VIDEO, url);
   }
 }
 
 QList<QString> ScreenScraper::getSearchNames(const QFileInfo &info)
 {
   QList<QString> hashList;
-  QCryptographicHash md5(QCryptographicHash::Md5);
-  QCryptographicHash sha1(QCryptographicHash::Sha1);
-  Crc32 crc;
-  crc.initInstance(1);
+  QString crcResult;
+  QString md5Result;
+  QString sha1Result;
 
   bool unpack = config->unpack;
 
   if(unpack) {
-    // Size limit for "unpack" is set to 8 megs to ensure the pi doesn't run out of memory
+    // Size limit for "unpack" is set to 80 megs to keep the decompression time reasonable
     if((info.suffix() == "7z" || info.suffix() == "zip") && info.size() < 81920000) {
       // For 7z (7z, zip) unpacked file reading
       {
@@ -482,56 +406,39 @@ QList<QString> ScreenScraper::getSearchNames(const QFileInfo &info)
       }
 
       if(unpack) {
+	// Digest the decompressed data as it comes out of the pipe instead of keeping it all
 	QProcess decProc;
-	decProc.setReadChannel(QProcess::StandardOutput);
-
+	Digest digest;
 	decProc.start("7z", QStringList({"x", "-so", info.absoluteFilePath()}));
-	if(decProc.waitForFinished(30000)) {
-	  if(decProc.exitStatus() == QProcess::NormalExit) {
-	    QByteArray allData = decProc.readAllStandardOutput();
-	    md5.addData(allData);
-	    sha1.addData(allData);
-	    crc.pushData(1, allData.data(), allData.length());
-	  } else {
-	    printf("Something went wrong when decompressing file to stdout, falling back...\n");
-	    unpack = false;
-	  }
+	if(digest.addProcessOutput(decProc, 30000)) {
+	  crcResult = digest.crc32();
+	  md5Result = digest.md5();
+	  sha1Result = digest.sha1();
 	} else {
-	  printf("Decompression process timed out or failed, falling back...\n");
+	  printf("Decompressing file to stdout timed out or failed, falling back...\n");
 	  unpack = false;
 	}
       }
     } else {
-      printf("File either not a compressed file or exceeds 8 meg size limit, falling back...\n");
+      printf("File either not a compressed file or exceeds 80 meg size limit, falling back...\n");
       unpack = false;
     }
   }
 
   if(!unpack) {
-    // For normal file reading
-    QFile romFile(info.absoluteFilePath());
-    romFile.open(QIODevice::ReadOnly);
-    while(!romFile.atEnd()) {
-      
-      QByteArray dataSeg = romFile.read(1024);
-      md5.addData(dataSeg);
-      sha1.addData(dataSeg);
-      crc.pushData(1, dataSeg.data(), dataSeg.length());
+    // For normal file reading. Reuse the checksums from the cache id calculation if available
+    DigestMemo memo;
+    if(Digest::recall(info, memo)) {
+      crcResult = memo.crc32;
+      md5Result = memo.md5;
+      sha1Result = memo.sha1;
+    } else {
+      Digest digest;
+      digest.addFile(info.absoluteFilePath());
+      crcResult = digest.crc32();
+      md5Result = digest.md5();
+      sha1Result = digest.sha1();
     }
-    romFile.close();
-  }
-
-  QString crcResult = QString::number(crc.releaseInstance(1), 16);
-  while(crcResult.length() < 8) {
-    crcResult.prepend("0");
-  }
-  QString md5Result = md5.result().toHex();
-  while(md5Result.length() < 32) {
-    md5Result.prepend("0");
-  }
-  QString sha1Result = sha1.result().toHex();
-  while(sha1Result.length() < 40) {
-    sha1Result.prepend("0");
   }
 
   // For some reason the APIv2 example from their website does not url encode '(' and ')'
@@ -27,8 +27,6 @@
 #define SCREENSCRAPER_H
 
 #include <QJsonObject>
-#include <QTimer>
-#include <QEventLoop>
 
 #include "abstractscraper.h"
 
@@ -44,8 +42,6 @@ public:
   ScreenScraper(Settings *config, QSharedPointer<NetManager> manager);
 
 private:
-  QTimer limitTimer;
-  QEventLoop limiter;
   QList<QString> getSearchNames(const QFileInfo &info) override;
   void getSearchResults(QList<GameEntry> &gameEntries, QString searchName, QString) override;
   void getGameData(GameEntry &game) override;
@@ -55,6 +55,9 @@ struct Settings {
   int doneThreads = 0;
   int threads = 4;
   bool threadsSet = false;
+  int compositeThreads = 0; // 0 means one per core
+  double requestsPerSecond = 0.0;
+  QString baseUrl = "";
   int minMatch = 65;
   bool minMatchSet = false;
   int notFound = 0;
@@ -95,6 +98,16 @@ struct Settings {
   bool gameListBackup = false;
   bool preserveOldGameList = true;
   bool spaceCheck = true;
+  int httpCacheSize = 200; // In MB, 0 disables the http cache
+  bool offline = false;
+  bool http2 = true;
+  QString userAgent = "";
+  int requestRetries = 3;
+  int requestTimeout = 30; // In seconds, per attempt
+  QString fixtureFolder = "fixtures";
+  bool record = false;
+  bool replay = false;
+  bool prefetch = false;
   QString scummIni = "";
 
   int romLimit = -1;
@@ -105,6 +118,7 @@ struct Settings {
   QString videoConvertCommand = "";
   QString videoConvertExtension = "";
   bool symlink = false;
+  bool hardlink = false;
   bool skipExistingVideos = false;
   bool cacheCovers = true;
   bool skipExistingCovers = false;
@@ -50,6 +50,7 @@
 #include "emulationstation.h"
 #include "attractmode.h"
 #include "pegasus.h"
+#include "thegamesdb.h"
 
 Skyscraper::Skyscraper(const QCommandLineParser &parser, const QString &currentDir)
 {
@@ -66,6 +67,11 @@ Skyscraper::Skyscraper(const QCommandLineParser &parser, const QString &currentD
 
   config.currentDir = currentDir;
   loadConfig(parser);
+
+  manager->setHttpCache("httpcache", (qint64)config.httpCacheSize * 1024 * 1024, config.offline);
+  manager->setTransport(config.http2, config.userAgent);
+  manager->setRetryPolicy(config.requestRetries, config.requestTimeout * 1000);
+  manager->setFixtures(config.fixtureFolder, config.record, config.replay);
 }
 
 Skyscraper::~Skyscraper()
@@ -106,6 +112,7 @@ void Skyscraper::run()
   doPrescrapeJobs();
 
   doneThreads = 0;
+  totalThreads = 0;
   notFound = 0;
   found = 0;
   avgCompleteness = 0;
@@ -186,6 +193,16 @@ void Skyscraper::run()
     }
     exit(0);
   }
+  if(config.cacheOptions.left(7) == "convert") {
+    QString format = "bin";
+    if(config.cacheOptions.contains(":")) {
+      format = config.cacheOptions.split(":").at(1);
+    }
+    state = 1; // Ignore ctrl+c
+    bool success = cache->convert(format);
+    state = 0;
+    exit(success?0:1);
+  }
   cache->readPriorities();
 
   QDir inputDir(config.inputFolder, Platform::getFormats(config.platform, config.extensions, config.addExtensions), QDir::Name, QDir::Files);
@@ -429,13 +446,54 @@ void Skyscraper::run()
     printf("\nNo entries to scrape...\n\n");
   }
 
+  // Hash all new files up front in parallel, the workers then only do quick id lookups.
+  // ScreenScraper identifies roms by checksums of the same data, so get those at the same time
+  if(totalFiles > 0) {
+    QElapsedTimer cacheIdTimer;
+    cacheIdTimer.start();
+    cache->prepareCacheIds(*queue, config.scraper == "screenscraper" && !config.unpack);
+    timings.cacheIds.store(cacheIdTimer.elapsed());
+  }
+
+  // Hand the files out to the workers so the ones that can be resolved from the cache are
+  // done first, while the ones that need the network queue up behind them
+  queue->distribute(config.threads, [this](const QFileInfo &info) {
+      if(config.scraper == "cache" ||
+	 config.scraper == "import" ||
+	 config.scraper == "esgamelist") {
+	return PRIOCACHED;
+      }
+      QString cacheId = cache->getCacheId(info);
+      if(config.onlyMissing && cache->hasEntries(cacheId)) {
+	return PRIOCACHED;
+      }
+      if(cache->hasEntries(cacheId, config.scraper)) {
+	return (config.refresh?PRIOREFRESH:PRIOCACHED);
+      }
+      return PRIONEW;
+    });
+
+  // The platform dump only spares online searches, so skip it if everything comes from the cache
+  if(config.prefetch && config.scraper == "thegamesdb" &&
+     queue->getPending(PRIONEW) + queue->getPending(PRIOREFRESH) > 0) {
+    TheGamesDb tgdb(&config, manager);
+    tgdb.loadPlatformDump();
+  }
+
   timer.start();
   currentFile = 1;
 
+  // The processing stage is cpu bound, so size it after the cores rather than the scraper threads
+  processPool.setMaxThreadCount(QThread::idealThreadCount());
+  // Artwork outputs are rendered and saved in parallel in a pool of their own
+  compositePool.setMaxThreadCount(config.compositeThreads > 0?config.compositeThreads:QThread::idealThreadCount());
+  // Blurs of large images split their rows over the cores in a pool of their own. They divide
+  // the cores between the blurs running at the same time, so this pool isn't multiplied by them
+
   QList<QThread*> threadList;
   for(int curThread = 1; curThread <= config.threads; ++curThread) {
     QThread *thread = new QThread;
-    ScraperWorker *worker = new ScraperWorker(queue, cache, manager, config, QString::number(curThread));
+    ScraperWorker *worker = new ScraperWorker(queue, cache, manager, &processPool, &compositePool, &timings, config, QString::number(curThread));
     worker->moveToThread(thread);
     connect(thread, &QThread::started, worker, &ScraperWorker::run);
     connect(worker, &ScraperWorker::entryReady, this, &Skyscraper::entryReady);
@@ -448,6 +506,21 @@ void Skyscraper::run()
       break;
     }
   }
+  // Cache hits and the local scraping modules never use the network. They get their own cpu
+  // sized set of threads that only take those entries, so they don't count against the
+  // thread limits of the scraping module
+  int cacheThreads = qMin(QThread::idealThreadCount(), queue->getPending(PRIOCACHED));
+  for(int curThread = config.threads + 1; curThread <= config.threads + cacheThreads; ++curThread) {
+    QThread *thread = new QThread;
+    ScraperWorker *worker = new ScraperWorker(queue, cache, manager, &processPool, &compositePool, &timings, config, QString::number(curThread), PRIOCACHED);
+    worker->moveToThread(thread);
+    connect(thread, &QThread::started, worker, &ScraperWorker::run);
+    connect(worker, &ScraperWorker::entryReady, this, &Skyscraper::entryReady);
+    connect(worker, &ScraperWorker::allDone, this, &Skyscraper::checkThreads);
+    connect(thread, &QThread::finished, worker, &ScraperWorker::deleteLater);
+    threadList.append(thread);
+  }
+  totalThreads = threadList.length();
   // Ready, set, GO! Start all threads
   for(const auto thread: threadList) {
     thread->start();
@@ -543,15 +616,15 @@ void Skyscraper::entryReady(const GameEntry &entry, const QString &output, const
        QStorageInfo(QDir(config.screenshotsFolder)).bytesFree() < spaceLimit) {
       printf("\033[1;31mYou have very little disk space left on the Skyscraper media export drive, please free up some space and try again. Now aborting...\033[0m\n\n");
       printf("Note! You can disable this check by setting 'spaceCheck=\"false\"' in the '[main]' section of config.ini.\n\n");
-      // By clearing the queue here we basically tell Skyscraper to stop and quit nicely
+      // By cancelling the queue here we basically tell Skyscraper to stop and quit nicely
       config.pretend = true;
-      queue->clearAll();
+      queue->cancel();
     } else if(QStorageInfo(QDir(config.cacheFolder)).bytesFree() < spaceLimit) {
       printf("\033[1;31mYou have very little disk space left on the Skyscraper resource cache drive, please free up some space and try again. Now aborting...\033[0m\n\n");
       printf("Note! You can disable this check by setting 'spaceCheck=\"false\"' in the '[main]' section of config.ini.\n\n");
-      // By clearing the queue here we basically tell Skyscraper to stop and quit nicely
+      // By cancelling the queue here we basically tell Skyscraper to stop and quit nicely
       config.pretend = true;
-      queue->clearAll();
+      queue->cancel();
     }
   }
 #endif
@@ -562,7 +635,7 @@ void Skyscraper::checkThreads()
   QMutexLocker locker(&checkThreadMutex);
 
   doneThreads++;
-  if(doneThreads != config.threads)
+  if(doneThreads != totalThreads)
     return;
 
   if(!config.pretend && config.scraper == "cache") {
@@ -600,6 +673,15 @@ void Skyscraper::checkThreads()
 
   printf("\033[1;34m---- And here are some neat stats :) ----\033[0m\n");
   printf("Total completion time: \033[1;33m%s\033[0m\n\n", secsToString(timer.elapsed()).toStdString().c_str());
+  printf("Time spent per stage (rom checksums as wall time, the rest summed over all threads):\n");
+  printf("  Rom checksums: \033[1;33m%.2f\033[0m seconds\n", timings.cacheIds.load() / 1000.0);
+  printf("  Searching:     \033[1;33m%.2f\033[0m seconds\n", timings.search.load() / 1000.0);
+  printf("  Game data:     \033[1;33m%.2f\033[0m seconds\n", timings.gameData.load() / 1000.0);
+  printf("  Processing:    \033[1;33m%.2f\033[0m seconds\n\n", timings.processing.load() / 1000.0);
+  if(manager->requests.load() > 0) {
+    printf("Network requests: \033[1;33m%d\033[0m (new secure connections: %d, over HTTP/2: %d)\n\n",
+	   manager->requests.load(), manager->handshakes.load(), manager->http2Replies.load());
+  }
   if(found > 0) {
     printf("Average search match: \033[1;33m%d%%\033[0m\n",
 	   (int)((double)avgSearchMatch / (double)found));
@@ -738,6 +820,9 @@ void Skyscraper::loadConfig(const QCommandLineParser &parser)
     config.threads = settings.value("threads").toInt();
     config.threadsSet = true;
   }
+  if(settings.contains("compositeThreads")) {
+    config.compositeThreads = settings.value("compositeThreads").toInt();
+  }
   if(settings.contains("emulator")) {
     config.frontendExtra = settings.value("emulator").toString();
   }
@@ -759,6 +844,9 @@ void Skyscraper::loadConfig(const QCommandLineParser &parser)
   if(settings.contains("symlink")) {
     config.symlink = settings.value("symlink").toBool();
   }
+  if(settings.contains("hardlink")) {
+    config.hardlink = settings.value("hardlink").toBool();
+  }
   if(settings.contains("theInFront")) {
     config.theInFront = settings.value("theInFront").toBool();
   }
@@ -875,6 +963,30 @@ void Skyscraper::loadConfig(const QCommandLineParser &parser)
   if(settings.contains("spaceCheck")) {
     config.spaceCheck = settings.value("spaceCheck").toBool();
   }
+  if(settings.contains("httpCacheSize")) {
+    config.httpCacheSize = settings.value("httpCacheSize").toInt();
+  }
+  if(settings.contains("offline")) {
+    config.offline = settings.value("offline").toBool();
+  }
+  if(settings.contains("http2")) {
+    config.http2 = settings.value("http2").toBool();
+  }
+  if(settings.contains("userAgent")) {
+    config.userAgent = settings.value("userAgent").toString();
+  }
+  if(settings.contains("requestRetries")) {
+    config.requestRetries = settings.value("requestRetries").toInt();
+  }
+  if(settings.contains("requestTimeout")) {
+    config.requestTimeout = settings.value("requestTimeout").toInt();
+  }
+  if(settings.contains("fixtureFolder")) {
+    config.fixtureFolder = settings.value("fixtureFolder").toString();
+  }
+  if(settings.contains("prefetch")) {
+    config.prefetch = settings.value("prefetch").toBool();
+  }
   if(settings.contains("nameTemplate")) {
     config.nameTemplate = settings.value("nameTemplate").toString();
   }
@@ -979,6 +1091,9 @@ void Skyscraper::loadConfig(const QCommandLineParser &parser)
   if(settings.contains("symlink")) {
     config.symlink = settings.value("symlink").toBool();
   }
+  if(settings.contains("hardlink")) {
+    config.hardlink = settings.value("hardlink").toBool();
+  }
   if(settings.contains("theInFront")) {
     config.theInFront = settings.value("theInFront").toBool();
   }
@@ -1106,6 +1221,9 @@ void Skyscraper::loadConfig(const QCommandLineParser &parser)
   if(settings.contains("symlink")) {
     config.symlink = settings.value("symlink").toBool();
   }
+  if(settings.contains("hardlink")) {
+    config.hardlink = settings.value("hardlink").toBool();
+  }
   if(settings.contains("theInFront")) {
     config.theInFront = settings.value("theInFront").toBool();
   }
@@ -1144,6 +1262,12 @@ void Skyscraper::loadConfig(const QCommandLineParser &parser)
     config.threads = settings.value("threads").toInt();
     config.threadsSet = true;
   }
+  if(settings.contains("requestsPerSecond")) {
+    config.requestsPerSecond = settings.value("requestsPerSecond").toDouble();
+  }
+  if(settings.contains("baseUrl")) {
+    config.baseUrl = settings.value("baseUrl").toString();
+  }
   if(settings.contains("minMatch")) {
     config.minMatch = settings.value("minMatch").toInt();
     config.minMatchSet = true;
@@ -1243,6 +1367,7 @@ void Skyscraper::loadConfig(const QCommandLineParser &parser)
       printf("Use comma-separated flags (eg. '--flags FLAG1,FLAG2') to enable multiple flags.\nThe following is a list of valid flags and what they do:\n");
 
       printf("  \033[1;33mforcefilename\033[0m: Use filename as game name instead of the returned game title when generating a game list. Consider using 'nameTemplate' config.ini option instead.\n");
+      printf("  \033[1;33mhardlink\033[0m: Hardlinks cached videos and unmodified artwork to the game list destination instead of copying them, if they are on the same filesystem as the cache.\n");
       printf("  \033[1;33minteractive\033[0m: Always ask user to choose best returned result from the scraping modules.\n");
       printf("  \033[1;33mnobrackets\033[0m: Disables any [] and () tags in the frontend game titles. Consider using 'nameTemplate' config.ini option instead.\n");
       printf("  \033[1;33mnocovers\033[0m: Disable covers/boxart from being cached locally. Only do this if you do not plan to use the cover artwork in 'artwork.xml'\n");
@@ -1253,9 +1378,13 @@ void Skyscraper::loadConfig(const QCommandLineParser &parser)
       printf("  \033[1;33mnoscreenshots\033[0m: Disable screenshots/snaps from being cached locally. Only do this if you do not plan to use the screenshot artwork in 'artwork.xml'\n");
       printf("  \033[1;33mnosubdirs\033[0m: Do not include input folder subdirectories when scraping.\n");
       printf("  \033[1;33mnowheels\033[0m: Disable wheels from being cached locally. Only do this if you do not plan to use the wheel artwork in 'artwork.xml'\n");
+      printf("  \033[1;33moffline\033[0m: Never use the network. All requests are answered from the http cache, and requests that aren't in it fail.\n");
       printf("  \033[1;33monlymissing\033[0m: Tells Skyscraper to skip all files which already have any data from any source in the cache.\n");
+      printf("  \033[1;33mprefetch\033[0m: Downloads a metadata dump for the entire platform once and resolves games from it, so only games that aren't in it are searched online. Only relevant for 'thegamesdb' scraping module.\n");
       printf("  \033[1;33mpretend\033[0m: Only relevant when generating a game list. It disables the game list generator and artwork compositor and only outputs the results of the potential game list generation to the terminal. Use it to check what and how the data will be combined from cached resources.\n");
+      printf("  \033[1;33mrecord\033[0m: Records all network requests and their replies to the 'fixtureFolder' set in config.ini, so the run can be replayed later with the 'replay' flag.\n");
       printf("  \033[1;33mrelative\033[0m: Forces all gamelist paths to be relative to rom location.\n");
+      printf("  \033[1;33mreplay\033[0m: Answers all network requests with the replies recorded by the 'record' flag without using the network. Useful for benchmarking and for reproducing problems.\n");
       printf("  \033[1;33mskipexistingcovers\033[0m: When generating gamelists, skip processing covers that already exist in the media output folder.\n");
       printf("  \033[1;33mskipexistingmarquees\033[0m: When generating gamelists, skip processing marquees that already exist in the media output folder.\n");
       printf("  \033[1;33mskipexistingscreenshots\033[0m: When generating gamelists, skip processing screenshots that already exist in the media output folder.\n");
@@ -1295,12 +1424,20 @@ void Skyscraper::loadConfig(const QCommandLineParser &parser)
 	  config.subdirs = false;
 	} else if(flag == "nowheels") {
 	  config.cacheWheels = false;
+	} else if(flag == "offline") {
+	  config.offline = true;
 	} else if(flag == "onlymissing") {
 	  config.onlyMissing = true;
+	} else if(flag == "prefetch") {
+	  config.prefetch = true;
 	} else if(flag == "pretend") {
 	  config.pretend = true;
+	} else if(flag == "record") {
+	  config.record = true;
 	} else if(flag == "relative") {
 	  config.relativePaths = true;
+	} else if(flag == "replay") {
+	  config.replay = true;
 	} else if(flag == "skipexistingcovers") {
 	  config.skipExistingCovers = true;
 	} else if(flag == "skipexistingmarquees") {
@@ -1315,6 +1452,8 @@ void Skyscraper::loadConfig(const QCommandLineParser &parser)
 	  config.skipped = true;
 	} else if(flag == "symlink") {
 	  config.symlink = true;
+	} else if(flag == "hardlink") {
+	  config.hardlink = true;
 	} else if(flag == "theinfront") {
 	  config.theInFront = true;
 	} else if(flag == "unattend") {
@@ -1330,6 +1469,10 @@ void Skyscraper::loadConfig(const QCommandLineParser &parser)
 	  exit(1);
 	}
       }
+      if(config.record && config.replay) {
+	printf("The 'record' and 'replay' flags can't be used at the same time. Exiting...\n");
+	exit(1);
+      }
     }
   }
   if(parser.isSet("videos")) {
@@ -1392,7 +1535,8 @@ void Skyscraper::loadConfig(const QCommandLineParser &parser)
       printf("  \033[1;33m--cache edit:new=<TYPE>\033[0m: Let's you batch add resources of <TYPE> to the selected platform for all files or a range of files. Add a filename on command line to edit cached resources for just that one file, use '--includefrom' to edit files created with the '--cache report' option or use '--startat' and '--endat' to edit a range of roms.\n");
       printf("  \033[1;33m--cache vacuum\033[0m: Compares your romset to any cached resource and removes the resources that you no longer have roms for.\n");
       printf("  \033[1;33m--cache report:missing=<OPTION>\033[0m: Generates reports with all files that are missing the specified resources. Check '--cache report:missing=help' for more info.\n");
-      printf("  \033[1;33m--cache merge:<PATH>\033[0m: Merges two resource caches together. It will merge the resource cache specified by <PATH> into the local resource cache by default. To merge into a non-default destination cache folder set it with '-d <PATH>'. Both should point to folders with the 'db.xml' inside.\n");
+      printf("  \033[1;33m--cache merge:<PATH>\033[0m: Merges two resource caches together. It will merge the resource cache specified by <PATH> into the local resource cache by default. To merge into a non-default destination cache folder set it with '-d <PATH>'. Both should point to folders with the 'db.xml' or 'db.bin' inside.\n");
+      printf("  \033[1;33m--cache convert[:bin|xml]\033[0m: Converts the resource cache database for the selected platform to the fast binary 'db.bin' format (default) or back to the 'db.xml' format.\n");
       printf("  \033[1;33m--cache purge:all\033[0m: Removes ALL cached resources for the selected platform.\n");
       printf("  \033[1;33m--cache purge:m=<MODULE>,t=<TYPE>\033[0m: Removes cached resources related to the selected module(m) and / or type(t). Either one can be left out in which case ALL resources from the selected module or ALL resources from the selected type will be removed.\n");
       printf("  \033[1;33m--cache refresh\033[0m: Forces a refresh of existing cached resources for any scraping module. Requires a scraping module set with '-s'. Similar to '--refresh'.\n");
@@ -1758,7 +1902,7 @@ void Skyscraper::doPrescrapeJobs()
       }
     } else {
       printf("Fetching limits for user '\033[1;33m%s\033[0m', just a sec...\n", config.user.toStdString().c_str());
-      netComm.request("https://www.screenscraper.fr/api2/ssuserInfos.php?devid=muldjord&devpassword=" + StrTools::unMagic("204;198;236;130;203;181;203;126;191;167;200;198;192;228;169;156") + "&softname=skyscraper" VERSION "&output=json&ssid=" + config.user + "&sspassword=" + config.password);
+      netComm.request((config.baseUrl.isEmpty()?"https://www.screenscraper.fr":config.baseUrl) + "/api2/ssuserInfos.php?devid=muldjord&devpassword=" + StrTools::unMagic("204;198;236;130;203;181;203;126;191;167;200;198;192;228;169;156") + "&softname=skyscraper" VERSION "&output=json&ssid=" + config.user + "&sspassword=" + config.password);
       q.exec();
       QJsonObject jsonObj = QJsonDocument::fromJson(netComm.getData()).object();
       if(jsonObj.isEmpty()) {
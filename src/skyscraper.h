@@ -80,6 +80,12 @@ private:
 
   QSharedPointer<Cache> cache;
 
+  // Declared before the pool, since the pool's jobs add to it until the pool is gone
+  StageTimings timings;
+  // Compositing and cache writes run here so the scraper threads can keep the network busy
+  QThreadPool processPool;
+  QThreadPool compositePool;
+
   QList<GameEntry> gameEntries;
   QList<QString> cliFiles;
   QMutex entryMutex;
@@ -88,6 +94,7 @@ private:
   QString gameListFileString;
   QString skippedFileString;
   int doneThreads;
+  int totalThreads;
   int notFound;
   int found;
   int avgSearchMatch;
@@ -24,9 +24,19 @@
  */
 
 #include <QJsonArray>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
 
 #include "thegamesdb.h"
 #include "strtools.h"
+#include "nametools.h"
+
+constexpr int DUMPMAXAGE = 7; // In days, older platform dumps are downloaded again
+constexpr int DUMPMAXPAGES = 1000; // Safeguard against endless 'next' page links
+
+QMap<QString, QJsonObject> TheGamesDb::dumpGames;
+QMultiMap<QString, QString> TheGamesDb::dumpNames;
 
 TheGamesDb::TheGamesDb(Settings *config,
 		       QSharedPointer<NetManager> manager)
@@ -55,6 +65,14 @@ TheGamesDb::TheGamesDb(Settings *config,
 void TheGamesDb::getSearchResults(QList<GameEntry> &gameEntries,
 				  QString searchName, QString platform)
 {
+  // Resolve from the prefetched platform dump if possible to spare a search request
+  for(const auto &id: dumpNames.values(searchName)) {
+    addSearchResult(gameEntries, id, dumpGames.value(id), platform);
+  }
+  if(!gameEntries.isEmpty()) {
+    return;
+  }
+
   netComm->request(searchUrlPre + StrTools::unMagic("187;161;217;126;172;149;202;122;163;197;163;219;162;171;203;197;139;151;215;173;122;206;161;162;200;216;217;123;124;215;200;170;171;132;158;155;215;120;149;169;140;164;122;154;178;174;160;172;157;131;210;161;203;137;159;117;205;166;162;139;171;169;210;163") + "&name="+ searchName);
   q.exec();
   data = netComm->getData();
@@ -79,42 +97,53 @@ void TheGamesDb::getSearchResults(QList<GameEntry> &gameEntries,
 
   while(!jsonGames.isEmpty()) {
     QJsonObject jsonGame = jsonGames.first().toObject();
-    
-    GameEntry game;
-    // https://api.thegamesdb.net/v1/Games/ByGameID?id=88&apikey=XXX&fields=game_title,players,release_date,developer,publisher,genres,overview,rating,platform
-    game.id = QString::number(jsonGame["id"].toInt());
-    game.url = "https://api.thegamesdb.net/v1/Games/ByGameID?id=" + game.id + "&apikey=" + StrTools::unMagic("187;161;217;126;172;149;202;122;163;197;163;219;162;171;203;197;139;151;215;173;122;206;161;162;200;216;217;123;124;215;200;170;171;132;158;155;215;120;149;169;140;164;122;154;178;174;160;172;157;131;210;161;203;137;159;117;205;166;162;139;171;169;210;163") + "&fields=game_title,players,release_date,developers,publishers,genres,overview,rating";
-    game.title = jsonGame["game_title"].toString();
-    // Remove anything at the end with a parentheses. 'thegamesdb' has a habit of adding
-    // for instance '(1993)' to the name.
-    game.title = game.title.left(game.title.indexOf("(")).simplified();
-    game.platform = platformMap[jsonGame["platform"].toInt()];
-    if(platformMatch(game.platform, platform)) {
-      gameEntries.append(game);
-    }
+    addSearchResult(gameEntries, QString::number(jsonGame["id"].toInt()), jsonGame, platform);
     jsonGames.removeFirst();
   }
 }
 
-void TheGamesDb::getGameData(GameEntry &game)
+// Search results and games from the platform dump have the same fields, so both end up as the
+// same entry
+void TheGamesDb::addSearchResult(QList<GameEntry> &gameEntries, const QString &id,
+				 const QJsonObject &jsonGame, const QString &platform)
 {
-  netComm->request(game.url);
-  q.exec();
-  data = netComm->getData();
-  jsonDoc = QJsonDocument::fromJson(data);
-  if(jsonDoc.isEmpty()) {
-    printf("No returned json data, is 'thegamesdb' down?\n");
-    reqRemaining = 0;
+  GameEntry game;
+  // https://api.thegamesdb.net/v1/Games/ByGameID?id=88&apikey=XXX&fields=game_title,players,release_date,developer,publisher,genres,overview,rating,platform
+  game.id = id;
+  game.url = baseUrl + "/Games/ByGameID?id=" + game.id + "&apikey=" + StrTools::unMagic("187;161;217;126;172;149;202;122;163;197;163;219;162;171;203;197;139;151;215;173;122;206;161;162;200;216;217;123;124;215;200;170;171;132;158;155;215;120;149;169;140;164;122;154;178;174;160;172;157;131;210;161;203;137;159;117;205;166;162;139;171;169;210;163") + "&fields=game_title,players,release_date,developers,publishers,genres,overview,rating";
+  game.title = jsonGame["game_title"].toString();
+  // Remove anything at the end with a parentheses. 'thegamesdb' has a habit of adding
+  // for instance '(1993)' to the name.
+  game.title = game.title.left(game.title.indexOf("(")).simplified();
+  game.platform = platformMap[jsonGame["platform"].toInt()];
+  if(platformMatch(game.platform, platform)) {
+    gameEntries.append(game);
   }
+}
 
-  reqRemaining = jsonDoc.object()["remaining_monthly_allowance"].toInt();
+void TheGamesDb::getGameData(GameEntry &game)
+{
+  if(dumpGames.contains(game.id)) {
+    jsonObj = dumpGames.value(game.id);
+  } else {
+    netComm->request(game.url);
+    q.exec();
+    data = netComm->getData();
+    jsonDoc = QJsonDocument::fromJson(data);
+    if(jsonDoc.isEmpty()) {
+      printf("No returned json data, is 'thegamesdb' down?\n");
+      reqRemaining = 0;
+    }
 
-  if(jsonDoc.object()["data"].toObject()["count"].toInt() < 1) {
-    printf("No returned json game document, is 'thegamesdb' down?\n");
-    reqRemaining = 0;
-  }
+    reqRemaining = jsonDoc.object()["remaining_monthly_allowance"].toInt();
 
-  jsonObj = jsonDoc.object()["data"].toObject()["games"].toArray().first().toObject();
+    if(jsonDoc.object()["data"].toObject()["count"].toInt() < 1) {
+      printf("No returned json game document, is 'thegamesdb' down?\n");
+      reqRemaining = 0;
+    }
+
+    jsonObj = jsonDoc.object()["data"].toObject()["games"].toArray().first().toObject();
+  }
 
   for(int a = 0; a < fetchOrder.length(); ++a) {
     switch(fetchOrder.at(a)) {
@@ -171,6 +200,103 @@ void TheGamesDb::getGameData(GameEntry &game)
       ;
     }
   }
+  fetchMedia(game);
+}
+
+void TheGamesDb::loadPlatformDump()
+{
+  QList<int> platformIds;
+  for(auto it = platformMap.cbegin(); it != platformMap.cend(); ++it) {
+    if(platformMatch(it.value(), config->platform)) {
+      platformIds.append(it.key());
+    }
+  }
+  if(platformIds.isEmpty()) {
+    printf("\033[1;33mPlatform '%s' isn't known by TheGamesDb, skipping prefetch\033[0m\n\n", config->platform.toStdString().c_str());
+    return;
+  }
+
+  QDir().mkpath("dumps");
+  QString fileName = "dumps/thegamesdb_" + config->platform + ".json";
+  QFileInfo dumpInfo(fileName);
+  if(!dumpInfo.exists() ||
+     dumpInfo.lastModified().daysTo(QDateTime::currentDateTime()) >= DUMPMAXAGE) {
+    printf("Fetching TheGamesDb platform dump for '%s', just a sec...", config->platform.toStdString().c_str());
+    fflush(stdout);
+    if(downloadPlatformDump(fileName, platformIds)) {
+      printf("\033[1;32m Success!\033[0m\n");
+    } else {
+      printf("\033[1;31m Failed!\033[0m\n");
+    }
+  }
+
+  QFile dumpFile(fileName);
+  if(!dumpFile.open(QIODevice::ReadOnly)) {
+    printf("\n");
+    return;
+  }
+  QJsonArray jsonGames = QJsonDocument::fromJson(dumpFile.readAll()).object()["games"].toArray();
+  dumpFile.close();
+
+  // Index by the same normalized names that 'getSearchNames' produces, so lookups are exact
+  for(const auto &jsonValue: jsonGames) {
+    QJsonObject jsonGame = jsonValue.toObject();
+    QString id = QString::number(jsonGame["id"].toInt());
+    dumpGames[id] = jsonGame;
+    QList<QString> names;
+    names.append(jsonGame["game_title"].toString());
+    for(const auto &alternate: jsonGame["alternates"].toArray()) {
+      names.append(alternate.toString());
+    }
+    for(const auto &name: names) {
+      QString searchName = NameTools::getUrlQueryName(name);
+      if(!searchName.isEmpty() && !dumpNames.contains(searchName, id)) {
+	dumpNames.insert(searchName, id);
+      }
+    }
+  }
+  printf("Indexed \033[1;32m%d\033[0m games from the platform dump, only misses will be searched online.\n\n", dumpGames.size());
+}
+
+bool TheGamesDb::downloadPlatformDump(const QString &fileName, const QList<int> &platformIds)
+{
+  QList<QString> ids;
+  for(const auto &platformId: platformIds) {
+    ids.append(QString::number(platformId));
+  }
+  QString url = baseUrl + "/Games/ByPlatformID?apikey=" + StrTools::unMagic("187;161;217;126;172;149;202;122;163;197;163;219;162;171;203;197;139;151;215;173;122;206;161;162;200;216;217;123;124;215;200;170;171;132;158;155;215;120;149;169;140;164;122;154;178;174;160;172;157;131;210;161;203;137;159;117;205;166;162;139;171;169;210;163") + "&id=" + ids.join(",") + "&fields=players,publishers,genres,overview,rating,alternates";
+
+  QJsonArray jsonGames;
+  int pages = 0;
+  while(!url.isEmpty() && pages < DUMPMAXPAGES) {
+    netComm->request(url);
+    q.exec();
+    jsonDoc = QJsonDocument::fromJson(netComm->getData());
+    if(jsonDoc.object()["status"].toString() != "Success") {
+      return false;
+    }
+    reqRemaining = jsonDoc.object()["remaining_monthly_allowance"].toInt();
+    for(const auto &jsonGame: jsonDoc.object()["data"].toObject()["games"].toArray()) {
+      jsonGames.append(jsonGame);
+    }
+    url = jsonDoc.object()["pages"].toObject()["next"].toString();
+    pages++;
+    printf(".");
+    fflush(stdout);
+  }
+  if(jsonGames.isEmpty()) {
+    return false;
+  }
+
+  QFile dumpFile(fileName);
+  if(!dumpFile.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+  QJsonObject jsonDump;
+  jsonDump["games"] = jsonGames;
+  dumpFile.write(QJsonDocument(jsonDump).toJson(QJsonDocument::Compact));
+  dumpFile.close();
+  return true;
 }
 
 void TheGamesDb::getReleaseDate(GameEntry &game)
@@ -225,46 +351,22 @@ void TheGamesDb::getTags(GameEntry &game)
 
 void TheGamesDb::getCover(GameEntry &game)
 {
-  netComm->request("https://cdn.thegamesdb.net/images/original/boxart/front/" + game.id + "-1.jpg");
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.coverData = netComm->getData();
-  }
+  addMediaRequest(COVER, "https://cdn.thegamesdb.net/images/original/boxart/front/" + game.id + "-1.jpg");
 }
 
 void TheGamesDb::getScreenshot(GameEntry &game)
 {
-  netComm->request("https://cdn.thegamesdb.net/images/original/screenshots/" + game.id + "-1.jpg");
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.screenshotData = netComm->getData();
-  }
+  addMediaRequest(SCREENSHOT, "https://cdn.thegamesdb.net/images/original/screenshots/" + game.id + "-1.jpg");
 }
 
 void TheGamesDb::getWheel(GameEntry &game)
 {
-  netComm->request("https://cdn.thegamesdb.net/images/original/clearlogo/" + game.id + ".png");
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.wheelData = netComm->getData();
-  }
+  addMediaRequest(WHEEL, "https://cdn.thegamesdb.net/images/original/clearlogo/" + game.id + ".png");
 }
 
 void TheGamesDb::getMarquee(GameEntry &game)
 {
-  netComm->request("https://cdn.thegamesdb.net/images/original/graphical/" + game.id + "-g.jpg");
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.marqueeData = netComm->getData();
-  }
+  addMediaRequest(MARQUEE, "https://cdn.thegamesdb.net/images/original/graphical/" + game.id + "-g.jpg");
 }
 
 void TheGamesDb::loadMaps()
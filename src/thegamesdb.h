@@ -37,6 +37,7 @@ class TheGamesDb : public AbstractScraper
 
 public:
   TheGamesDb(Settings *config, QSharedPointer<NetManager> manager);
+  void loadPlatformDump();
 
 private:
   void getSearchResults(QList<GameEntry> &gameEntries,
@@ -58,6 +59,15 @@ private:
   QJsonDocument jsonDoc;
   QJsonObject jsonObj;
 
+  // Prefetched platform dump shared by all instances. It's filled before the scraper threads
+  // start and only read after that
+  static QMap<QString, QJsonObject> dumpGames; // Game id -> game
+  static QMultiMap<QString, QString> dumpNames; // Search name -> game ids in 'dumpGames'
+
+  bool downloadPlatformDump(const QString &fileName, const QList<int> &platformIds);
+  void addSearchResult(QList<GameEntry> &gameEntries, const QString &id,
+		       const QJsonObject &jsonGame, const QString &platform);
+
   void loadMaps();
   QMap<int, QString> platformMap;
   QMap<int, QString> genreMap;
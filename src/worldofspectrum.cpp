@@ -124,7 +124,7 @@ void WorldOfSpectrum::getDescription(GameEntry &game)
   game.description = StrTools::stripHtmlTags(game.description);
 }
 
-void WorldOfSpectrum::getCover(GameEntry &game)
+void WorldOfSpectrum::getCover(GameEntry &)
 {
   for(const auto &nom: coverPre) {
     nomNom(nom);
@@ -135,19 +135,13 @@ void WorldOfSpectrum::getCover(GameEntry &game)
   nomNom("<A HREF=\"");
   QString coverUrl = data.left(data.indexOf(coverPost.toUtf8()));
   if(coverUrl.indexOf("http") != -1) {
-    netComm->request(coverUrl);
+    addMediaRequest(COVER, coverUrl);
   } else {
-    netComm->request(baseUrl + (coverUrl.left(1) == "/"?"":"/") + coverUrl);
-  }
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.coverData = netComm->getData();
+    addMediaRequest(COVER, baseUrl + (coverUrl.left(1) == "/"?"":"/") + coverUrl);
   }
 }
 
-void WorldOfSpectrum::getScreenshot(GameEntry &game)
+void WorldOfSpectrum::getScreenshot(GameEntry &)
 {
   if(data.indexOf("<IMG SRC=\"/pub/sinclair/screens/in-game") == -1) {
     return;
@@ -156,15 +150,9 @@ void WorldOfSpectrum::getScreenshot(GameEntry &game)
   nomNom("<IMG SRC=\"");
   QString screenshotUrl = data.left(data.indexOf(screenshotPost.toUtf8()));
   if(screenshotUrl.indexOf("http") != -1) {
-    netComm->request(screenshotUrl);
+    addMediaRequest(SCREENSHOT, screenshotUrl);
   } else {
-    netComm->request(baseUrl + (screenshotUrl.left(1) == "/"?"":"/") + screenshotUrl);
-  }
-  q.exec();
-  QImage image;
-  if(netComm->getError() == QNetworkReply::NoError &&
-     image.loadFromData(netComm->getData())) {
-    game.screenshotData = netComm->getData();
+    addMediaRequest(SCREENSHOT, baseUrl + (screenshotUrl.left(1) == "/"?"":"/") + screenshotUrl);
   }
 }
 
@@ -0,0 +1,255 @@
+/***************************************************************************
+ *            main.cpp
+ *
+ *  Sat Oct 17 12:00:00 CEST 2026
+ *  Copyright 2026 Lars Muldjord
+ *  muldjordlars@gmail.com
+ ****************************************************************************/
+/*
+ *  This file is part of skyscraper.
+ *
+ *  skyscraper is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  skyscraper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with skyscraper; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <functional>
+
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QSemaphore>
+
+#include "netcomm.h"
+
+// Answers every request on localhost and counts how many actually reached it. The body of a
+// reply is picked by path, '/busy' answers like a service that is too busy the first time.
+// Replies are held back for 'delay' ms, so requests from several threads overlap
+class CountingServer : public QTcpServer
+{
+public:
+  CountingServer()
+  {
+    connect(this, &QTcpServer::newConnection, this, &CountingServer::accept);
+    listen(QHostAddress::LocalHost);
+  }
+  QString url(const QString &path)
+  {
+    return "http://127.0.0.1:" + QString::number(serverPort()) + path;
+  }
+  int hits = 0;
+  int delay = 0;
+
+private:
+  void accept()
+  {
+    while(hasPendingConnections()) {
+      QTcpSocket *socket = nextPendingConnection();
+      connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+      connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+	  buffers[socket].append(socket->readAll());
+	  if(!buffers[socket].contains("\r\n\r\n")) {
+	    return;
+	  }
+	  QByteArray path = buffers.take(socket).split(' ').value(1).split('?').first();
+	  QByteArray body;
+	  if(path == "/busy") {
+	    body = (hits == 0?"too many threads":"{\"success\":\"true\"}");
+	  } else if(path == "/game") {
+	    body = "{\"success\":\"true\"}";
+	  }
+	  hits++;
+	  QTimer::singleShot(delay, socket, [socket, body]() {
+	      socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nConnection: close\r\n"
+			    "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n" + body);
+	      socket->disconnectFromHost();
+	    });
+	});
+    }
+  }
+  QMap<QTcpSocket *, QByteArray> buffers;
+};
+
+// Runs a job with a NetComm of its own in a separate thread, like the scraper threads do. The
+// server lives in the main thread, so the test has to keep its event loop running meanwhile
+class Worker : public QThread
+{
+public:
+  Worker(QSharedPointer<NetManager> manager, std::function<void(NetComm &)> job)
+    : manager(manager), job(job)
+  {
+  }
+  ~Worker()
+  {
+    // A deadlocked worker would otherwise abort the whole test run
+    if(isRunning()) {
+      terminate();
+      wait();
+    }
+  }
+
+protected:
+  void run() override
+  {
+    NetComm netComm(manager);
+    job(netComm);
+  }
+
+private:
+  QSharedPointer<NetManager> manager;
+  std::function<void(NetComm &)> job;
+};
+
+constexpr char GAME[] = "{\"success\":\"true\"}";
+
+class NetCommTest : public QObject
+{
+  Q_OBJECT
+
+private:
+  QByteArray get(NetComm &netComm, const QString &url)
+  {
+    QSignalSpy ready(&netComm, &NetComm::dataReady);
+    netComm.request(url);
+    if(ready.isEmpty()) {
+      ready.wait(10000);
+    }
+    return netComm.getData();
+  }
+  // Waits the way the scraping modules do, which also works outside the main thread
+  static QByteArray getInThread(NetComm &netComm, const QString &url)
+  {
+    QEventLoop q;
+    connect(&netComm, &NetComm::dataReady, &q, &QEventLoop::quit);
+    netComm.request(url);
+    q.exec();
+    return netComm.getData();
+  }
+  static QList<BatchRequest> makeBatch(const QList<QString> &urls)
+  {
+    QList<BatchRequest> requests;
+    for(const auto &url: urls) {
+      BatchRequest batchRequest;
+      batchRequest.url = url;
+      requests.append(batchRequest);
+    }
+    return requests;
+  }
+
+private slots:
+  void memoAnswersRepeats()
+  {
+    CountingServer server;
+    NetComm netComm(QSharedPointer<NetManager>(new NetManager));
+    QCOMPARE(get(netComm, server.url("/game")), QByteArray("{\"success\":\"true\"}"));
+    QCOMPARE(get(netComm, server.url("/game")), QByteArray("{\"success\":\"true\"}"));
+    QCOMPARE(server.hits, 1);
+  }
+
+  void retryAfterForgetReachesNetwork()
+  {
+    CountingServer server;
+    NetComm netComm(QSharedPointer<NetManager>(new NetManager));
+    QCOMPARE(get(netComm, server.url("/busy")), QByteArray("too many threads"));
+    netComm.forgetReply();
+    QCOMPARE(get(netComm, server.url("/busy")), QByteArray("{\"success\":\"true\"}"));
+    QCOMPARE(server.hits, 2);
+  }
+
+  void emptyRepliesAreNotRemembered()
+  {
+    CountingServer server;
+    NetComm netComm(QSharedPointer<NetManager>(new NetManager));
+    QVERIFY(get(netComm, server.url("/empty")).isEmpty());
+    QVERIFY(get(netComm, server.url("/empty")).isEmpty());
+    QCOMPARE(server.hits, 2);
+  }
+
+  void concurrentRequestsShareOneFlight()
+  {
+    CountingServer server;
+    server.delay = 1000;
+    QSharedPointer<NetManager> manager(new NetManager);
+    QString url = server.url("/game");
+    QByteArray leaderData, followerData;
+    Worker leader(manager, [&](NetComm &netComm) {
+	leaderData = getInThread(netComm, url);
+      });
+    Worker follower(manager, [&](NetComm &netComm) {
+	followerData = getInThread(netComm, url);
+      });
+    leader.start();
+    // Only start the second thread once the first one's request is in the air
+    QTRY_COMPARE(server.hits, 1);
+    follower.start();
+    QTRY_VERIFY_WITH_TIMEOUT(leader.isFinished() && follower.isFinished(), 10000);
+    QCOMPARE(leaderData, QByteArray(GAME));
+    QCOMPARE(followerData, QByteArray(GAME));
+    QCOMPARE(server.hits, 1);
+  }
+
+  void duplicateFromOwnerThreadIsSent()
+  {
+    CountingServer server;
+    server.delay = 200;
+    QSharedPointer<NetManager> manager(new NetManager);
+    NetComm first(manager);
+    NetComm second(manager);
+    QSignalSpy firstReady(&first, &NetComm::dataReady);
+    QSignalSpy secondReady(&second, &NetComm::dataReady);
+    // The second request is made while this thread's own flight is outstanding. Waiting for it
+    // would never end, so it must go out on its own
+    first.request(server.url("/game"));
+    second.request(server.url("/game"));
+    QTRY_VERIFY_WITH_TIMEOUT(!firstReady.isEmpty() && !secondReady.isEmpty(), 10000);
+    QCOMPARE(first.getData(), QByteArray(GAME));
+    QCOMPARE(second.getData(), QByteArray(GAME));
+    QCOMPARE(server.hits, 2);
+  }
+
+  void crossedBatchesDontDeadlock()
+  {
+    CountingServer server;
+    server.delay = 50;
+    QSharedPointer<NetManager> manager(new NetManager);
+    // Each thread may lead one url and follow the other. That only works out if both hand over
+    // their own results before waiting for the other's, so repeat to hit the interleavings
+    constexpr int ROUNDS = 20;
+    for(int round = 0; round < ROUNDS; ++round) {
+      QString urlA = server.url("/game?round=" + QString::number(round) + "&part=a");
+      QString urlB = server.url("/game?round=" + QString::number(round) + "&part=b");
+      QList<BatchRequest> forward = makeBatch({urlA, urlB});
+      QList<BatchRequest> backward = makeBatch({urlB, urlA});
+      QSemaphore gate;
+      Worker first(manager, [&](NetComm &netComm) {
+	  gate.acquire();
+	  netComm.requestBatch(forward);
+	});
+      Worker second(manager, [&](NetComm &netComm) {
+	  gate.acquire();
+	  netComm.requestBatch(backward);
+	});
+      first.start();
+      second.start();
+      gate.release(2);
+      QTRY_VERIFY_WITH_TIMEOUT(first.isFinished() && second.isFinished(), 10000);
+      for(const auto &batchRequest: forward + backward) {
+	QCOMPARE(batchRequest.data, QByteArray(GAME));
+      }
+    }
+    QCOMPARE(server.hits, 2 * ROUNDS);
+  }
+};
+
+QTEST_GUILESS_MAIN(NetCommTest)
+#include "main.moc"
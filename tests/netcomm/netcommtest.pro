@@ -0,0 +1,22 @@
+# Tests for the request sharing in NetComm and NetManager. Build and run them from this folder with:
+#   qmake && make && ./netcommtest
+TEMPLATE = app
+TARGET = netcommtest
+DEPENDPATH += . ../../src
+INCLUDEPATH += . ../../src
+CONFIG += console testcase
+CONFIG -= app_bundle
+QT += core network testlib
+QT -= gui
+QMAKE_CXXFLAGS += -std=c++11
+
+HEADERS += ../../src/netcomm.h \
+           ../../src/netmanager.h \
+           ../../src/httpcache.h \
+           ../../src/fixturestore.h
+
+SOURCES += main.cpp \
+           ../../src/netcomm.cpp \
+           ../../src/netmanager.cpp \
+           ../../src/httpcache.cpp \
+           ../../src/fixturestore.cpp